@@ -0,0 +1,362 @@
+#include "batch_graph.h"
+#include "graph.h"
+#include "numeric.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+namespace {
+
+/// Sets out[l] = f(a[l]) for every lane.
+template <typename F>
+void Map(double *out, const double *a, size_t lanes, F f) {
+  for (size_t l = 0; l < lanes; l++) {
+    out[l] = f(a[l]);
+  }
+}
+
+/// Sets out[l] = f(a[l], b[l]) for every lane.
+template <typename F>
+void Map(double *out, const double *a, const double *b, size_t lanes, F f) {
+  for (size_t l = 0; l < lanes; l++) {
+    out[l] = f(a[l], b[l]);
+  }
+}
+
+/// Adds f(l) to grad[l] for every lane.
+template <typename F> void Accumulate(double *grad, size_t lanes, F f) {
+  for (size_t l = 0; l < lanes; l++) {
+    grad[l] += f(l);
+  }
+}
+
+} // namespace
+
+BatchGraph::BatchGraph(std::shared_ptr<GradNode> output,
+                       std::vector<std::shared_ptr<GradNode>> inputs,
+                       size_t batch_size)
+    : output_(std::move(output)), inputs_(std::move(inputs)),
+      batch_size_(batch_size) {
+  if (batch_size_ == 0) {
+    throw std::invalid_argument("BatchGraph batch size must be positive");
+  }
+  std::unordered_map<const GradNode *, size_t> input_index;
+  for (size_t i = 0; i < inputs_.size(); i++) {
+    if (!inputs_[i]->children_.empty()) {
+      throw std::invalid_argument("BatchGraph inputs must be leaf nodes");
+    }
+    input_index[inputs_[i].get()] = i;
+  }
+
+  std::vector<GradNode *> order;
+  internal::TopologicalSort(output_.get(), &order);
+  std::unordered_map<const GradNode *, size_t> rows;
+  input_rows_.assign(inputs_.size(), kNoRow);
+  needs_grad_.assign(order.size(), false);
+  for (size_t row = 0; row < order.size(); row++) {
+    auto *node = order[row];
+    rows[node] = row;
+    if (node->children_.empty()) {
+      auto found = input_index.find(node);
+      if (found != input_index.end()) {
+        input_rows_[found->second] = row;
+      } else {
+        leaves_.emplace_back(node, row);
+      }
+      needs_grad_[row] = !node->is_scalar_;
+      continue;
+    }
+    if (node->op_ == GradNode::Op::kCustom) {
+      throw std::invalid_argument("BatchGraph cannot recompute custom nodes");
+    }
+
+    Step step{node->op_, row, children_.size(), node->children_.size(),
+              node->operand_};
+    for (size_t i = 0; i < node->children_.size(); i++) {
+      auto child = rows.at(node->children_[i].get());
+      children_.push_back(child);
+      operands_.push_back(i < node->operands_.size() ? node->operands_[i]
+                                                     : 0.0);
+      needs_grad_[row] = needs_grad_[row] || needs_grad_[child];
+    }
+    needs_grad_[row] = needs_grad_[row] && !node->is_scalar_;
+    steps_.push_back(step);
+  }
+  output_row_ = rows.at(output_.get());
+  values_.assign(order.size() * batch_size_, 0.0);
+  grads_.assign(order.size() * batch_size_, 0.0);
+}
+
+const std::vector<double> &
+BatchGraph::Forward(const std::vector<std::vector<double>> &samples) {
+  if (samples.empty() || samples.size() > batch_size_) {
+    throw std::invalid_argument("BatchGraph sample count does not fit");
+  }
+  lanes_ = samples.size();
+  for (size_t l = 0; l < lanes_; l++) {
+    if (samples[l].size() != inputs_.size()) {
+      throw std::invalid_argument("BatchGraph input count does not match");
+    }
+    for (size_t i = 0; i < inputs_.size(); i++) {
+      if (input_rows_[i] != kNoRow) {
+        Values(input_rows_[i])[l] = samples[l][i];
+      }
+    }
+  }
+  for (auto &leaf : leaves_) {
+    std::fill_n(Values(leaf.second), lanes_, leaf.first->data_);
+  }
+  for (auto &step : steps_) {
+    RunForward(step);
+  }
+  auto *output = Values(output_row_);
+  outputs_.assign(output, output + lanes_);
+  return outputs_;
+}
+
+void BatchGraph::Backward() {
+  std::fill(grads_.begin(), grads_.end(), 0.0);
+  std::fill_n(Grads(output_row_), lanes_, 1.0);
+  for (auto it = steps_.rbegin(); it != steps_.rend(); ++it) {
+    if (needs_grad_[it->row]) {
+      RunBackward(*it);
+    }
+  }
+  for (auto &leaf : leaves_) {
+    if (!needs_grad_[leaf.second]) {
+      continue;
+    }
+    auto *grad = Grads(leaf.second);
+    double sum = 0.0;
+    for (size_t l = 0; l < lanes_; l++) {
+      sum += grad[l];
+    }
+    leaf.first->grad_ += sum;
+  }
+}
+
+double BatchGraph::InputGrad(size_t sample, size_t input) const {
+  if (input_rows_[input] == kNoRow) {
+    return 0.0;
+  }
+  return grads_[input_rows_[input] * batch_size_ + sample];
+}
+
+void BatchGraph::RunForward(const Step &step) {
+  auto *out = Values(step.row);
+  auto child = [&](size_t i) -> const double * {
+    return Values(children_[step.first_child + i]);
+  };
+  auto c = step.operand;
+  auto n = lanes_;
+  switch (step.op) {
+  case GradNode::Op::kAdd:
+    Map(out, child(0), child(1), n, [](double a, double b) { return a + b; });
+    break;
+  case GradNode::Op::kSub:
+    Map(out, child(0), child(1), n, [](double a, double b) { return a - b; });
+    break;
+  case GradNode::Op::kMul:
+    Map(out, child(0), child(1), n, [](double a, double b) { return a * b; });
+    break;
+  case GradNode::Op::kDiv:
+    Map(out, child(0), child(1), n, [](double a, double b) { return a / b; });
+    break;
+  case GradNode::Op::kPow:
+    Map(out, child(0), child(1), n,
+        [](double a, double b) { return std::pow(a, b); });
+    break;
+  case GradNode::Op::kLog:
+    Map(out, child(0), n, [](double a) { return std::log(a); });
+    break;
+  case GradNode::Op::kSigmoid:
+    Map(out, child(0), n, internal::StableSigmoid<double>);
+    break;
+  case GradNode::Op::kTanh:
+    Map(out, child(0), n, [](double a) { return std::tanh(a); });
+    break;
+  case GradNode::Op::kRelu:
+    Map(out, child(0), n, [](double a) { return std::max(a, 0.0); });
+    break;
+  case GradNode::Op::kAddConstant:
+    Map(out, child(0), n, [c](double a) { return a + c; });
+    break;
+  case GradNode::Op::kSubConstant:
+    Map(out, child(0), n, [c](double a) { return a - c; });
+    break;
+  case GradNode::Op::kRSubConstant:
+    Map(out, child(0), n, [c](double a) { return c - a; });
+    break;
+  case GradNode::Op::kMulConstant:
+    Map(out, child(0), n, [c](double a) { return a * c; });
+    break;
+  case GradNode::Op::kDivConstant:
+    Map(out, child(0), n, [c](double a) { return a / c; });
+    break;
+  case GradNode::Op::kRDivConstant:
+    Map(out, child(0), n, [c](double a) { return c / a; });
+    break;
+  case GradNode::Op::kPowConstant:
+    // Squares, as in squared-error losses, vectorize without calling pow.
+    if (c == 2.0) {
+      Map(out, child(0), n, [](double a) { return a * a; });
+    } else {
+      Map(out, child(0), n, [c](double a) { return std::pow(a, c); });
+    }
+    break;
+  case GradNode::Op::kSum:
+    std::copy_n(child(0), n, out);
+    for (size_t i = 1; i < step.num_children; i++) {
+      Map(out, out, child(i), n, [](double a, double b) { return a + b; });
+    }
+    break;
+  case GradNode::Op::kDot: {
+    auto half = step.num_children / 2;
+    Map(out, child(0), child(half), n,
+        [](double a, double b) { return a * b; });
+    for (size_t i = 1; i < half; i++) {
+      auto *a = child(i);
+      auto *b = child(half + i);
+      for (size_t l = 0; l < n; l++) {
+        out[l] += a[l] * b[l];
+      }
+    }
+    break;
+  }
+  case GradNode::Op::kDotConstant: {
+    auto *w = operands_.data() + step.first_child;
+    Map(out, child(0), n, [w](double a) { return a * w[0]; });
+    for (size_t i = 1; i < step.num_children; i++) {
+      auto *a = child(i);
+      for (size_t l = 0; l < n; l++) {
+        out[l] += a[l] * w[i];
+      }
+    }
+    break;
+  }
+  case GradNode::Op::kLeaf:
+  case GradNode::Op::kCustom:
+    break;
+  }
+}
+
+void BatchGraph::RunBackward(const Step &step) {
+  const double *g = Grads(step.row);
+  const double *out = Values(step.row);
+  auto row = [&](size_t i) { return children_[step.first_child + i]; };
+  auto value = [&](size_t i) -> const double * { return Values(row(i)); };
+  // Adds contribution(l) to the gradient of child i, if it needs one.
+  auto add = [&](size_t i, auto contribution) {
+    if (needs_grad_[row(i)]) {
+      Accumulate(Grads(row(i)), lanes_, contribution);
+    }
+  };
+  auto c = step.operand;
+  switch (step.op) {
+  case GradNode::Op::kAdd:
+  case GradNode::Op::kSum:
+  case GradNode::Op::kAddConstant:
+  case GradNode::Op::kSubConstant:
+    for (size_t i = 0; i < step.num_children; i++) {
+      add(i, [g](size_t l) { return g[l]; });
+    }
+    break;
+  case GradNode::Op::kSub:
+    add(0, [g](size_t l) { return g[l]; });
+    add(1, [g](size_t l) { return -g[l]; });
+    break;
+  case GradNode::Op::kRSubConstant:
+    add(0, [g](size_t l) { return -g[l]; });
+    break;
+  case GradNode::Op::kMul: {
+    auto *a = value(0);
+    auto *b = value(1);
+    add(0, [g, b](size_t l) { return g[l] * b[l]; });
+    add(1, [g, a](size_t l) { return g[l] * a[l]; });
+    break;
+  }
+  case GradNode::Op::kDiv: {
+    auto *a = value(0);
+    auto *b = value(1);
+    add(0, [g, b](size_t l) { return g[l] / b[l]; });
+    add(1, [g, a, b](size_t l) { return -(g[l] * a[l] / (b[l] * b[l])); });
+    break;
+  }
+  case GradNode::Op::kPow: {
+    auto *a = value(0);
+    auto *b = value(1);
+    add(0, [g, a, b](size_t l) {
+      return g[l] * b[l] * std::pow(a[l], b[l] - 1);
+    });
+    add(1, [g, a, out](size_t l) { return g[l] * out[l] * std::log(a[l]); });
+    break;
+  }
+  case GradNode::Op::kLog: {
+    auto *a = value(0);
+    add(0, [g, a](size_t l) { return g[l] * (1.0 / a[l]); });
+    break;
+  }
+  case GradNode::Op::kSigmoid:
+    add(0, [g, out](size_t l) { return g[l] * out[l] * (1.0 - out[l]); });
+    break;
+  case GradNode::Op::kTanh:
+    add(0, [g, out](size_t l) { return g[l] * (1.0 - out[l] * out[l]); });
+    break;
+  case GradNode::Op::kRelu: {
+    auto *a = value(0);
+    add(0, [g, a](size_t l) { return a[l] > 0 ? g[l] : 0.0; });
+    break;
+  }
+  case GradNode::Op::kMulConstant:
+    add(0, [g, c](size_t l) { return g[l] * c; });
+    break;
+  case GradNode::Op::kDivConstant:
+    add(0, [g, c](size_t l) { return g[l] / c; });
+    break;
+  case GradNode::Op::kRDivConstant: {
+    auto *a = value(0);
+    add(0, [g, a, c](size_t l) { return -(g[l] * c / (a[l] * a[l])); });
+    break;
+  }
+  case GradNode::Op::kPowConstant: {
+    auto *a = value(0);
+    if (c == 2.0) {
+      add(0, [g, a](size_t l) { return g[l] * 2.0 * a[l]; });
+    } else {
+      add(0, [g, a, c](size_t l) { return g[l] * c * std::pow(a[l], c - 1); });
+    }
+    break;
+  }
+  case GradNode::Op::kDot: {
+    auto half = step.num_children / 2;
+    for (size_t i = 0; i < half; i++) {
+      auto *a = value(i);
+      auto *b = value(half + i);
+      add(i, [g, b](size_t l) { return g[l] * b[l]; });
+      add(half + i, [g, a](size_t l) { return g[l] * a[l]; });
+    }
+    break;
+  }
+  case GradNode::Op::kDotConstant:
+    for (size_t i = 0; i < step.num_children; i++) {
+      auto w = operands_[step.first_child + i];
+      add(i, [g, w](size_t l) { return g[l] * w; });
+    }
+    break;
+  case GradNode::Op::kLeaf:
+  case GradNode::Op::kCustom:
+    break;
+  }
+}
+
+} // namespace micrograd
+} // namespace apexkid
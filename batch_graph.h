@@ -0,0 +1,133 @@
+#ifndef BATCH_GRAPH_H
+#define BATCH_GRAPH_H
+
+#include "micrograd.h"
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+/**
+ * @class BatchGraph
+ * @brief A scalar GradNode graph evaluated for many samples at once.
+ *
+ * Like StaticGraph, BatchGraph captures a graph once, with leaf nodes as
+ * placeholders for the inputs of one sample. It then gives every node a lane
+ * per sample instead of a single value: Forward() and Backward() run each
+ * operation as one loop over the lanes, which the compiler vectorizes, so the
+ * cost of visiting a node is shared by the whole batch.
+ *
+ * The values and gradients live in the BatchGraph, not in the nodes. Leaves
+ * other than the placeholders, such as parameters, are read from their nodes
+ * by every Forward() and receive the sum of their gradients over the lanes in
+ * Backward(), as if the graph had been replayed for each sample in turn.
+ */
+class BatchGraph {
+public:
+  /**
+   * @brief Captures the graph computing an output.
+   * @param output The node computing the result of the graph.
+   * @param inputs The leaf nodes whose values Forward() sets, in order.
+   * @param batch_size The largest number of samples evaluated at once.
+   * @throws std::invalid_argument If an input is not a leaf, the graph
+   * contains a custom node that cannot be recomputed, or the batch size is 0.
+   */
+  BatchGraph(std::shared_ptr<GradNode> output,
+             std::vector<std::shared_ptr<GradNode>> inputs, size_t batch_size);
+
+  /**
+   * @brief Evaluates the graph for a batch of samples.
+   * @param samples The input values of each sample, in the order the inputs
+   * were captured.
+   * @return The value of the output for each sample.
+   * @throws std::invalid_argument If there are no samples or more than the
+   * batch size, or a sample has the wrong number of values.
+   */
+  const std::vector<double> &
+  Forward(const std::vector<std::vector<double>> &samples);
+
+  /**
+   * @brief Computes gradients of the outputs for the last Forward().
+   *
+   * The gradients of the other leaves are accumulated into, summed over the
+   * samples; the gradients of the inputs are kept per sample.
+   */
+  void Backward();
+
+  /**
+   * @brief Gets the gradient of an input for one sample.
+   * @param sample The index of the sample in the last Forward().
+   * @param input The index of the input.
+   * @return The gradient of the output of the sample with respect to the
+   * input, as of the last Backward(). It is 0 for an input the output does
+   * not depend on.
+   */
+  double InputGrad(size_t sample, size_t input) const;
+
+  /**
+   * @brief Gets the largest number of samples evaluated at once.
+   * @return The batch size.
+   */
+  size_t BatchSize() const { return batch_size_; }
+
+  /**
+   * @brief Gets the number of operations run by Forward().
+   * @return The number of interior nodes, including the output.
+   */
+  size_t Size() const { return steps_.size(); }
+
+private:
+  /// Marks an input that the output does not depend on, which has no row.
+  static constexpr size_t kNoRow = std::numeric_limits<size_t>::max();
+
+  /// An interior node, with the rows of its lanes and of its children.
+  struct Step {
+    GradNode::Op op;
+    size_t row;
+    size_t first_child; // Into children_ and operands_.
+    size_t num_children;
+    double operand;
+  };
+
+  /// Gets the lanes holding the values of a node.
+  double *Values(size_t row) { return values_.data() + row * batch_size_; }
+
+  /// Gets the lanes holding the gradients of a node.
+  double *Grads(size_t row) { return grads_.data() + row * batch_size_; }
+
+  /// Computes the values of a node from those of its children.
+  void RunForward(const Step &step);
+
+  /// Passes the gradients of a node to its children.
+  void RunBackward(const Step &step);
+
+  std::shared_ptr<GradNode> output_;              // Keeps the graph alive.
+  std::vector<std::shared_ptr<GradNode>> inputs_; // Placeholder leaves.
+  size_t batch_size_;
+  size_t lanes_ = 0; // The number of samples in the last Forward().
+  // Interior nodes with every child before its parents, so the output comes
+  // last.
+  std::vector<Step> steps_;
+  std::vector<size_t> children_; // Rows of the children of every step.
+  std::vector<double> operands_; // Constants of kDotConstant steps.
+  std::vector<bool> needs_grad_; // Whether a gradient flows in, by row.
+  // The row of each input, or kNoRow if the output does not depend on it.
+  std::vector<size_t> input_rows_;
+  // Leaves that are not inputs, which are read and updated through the node.
+  std::vector<std::pair<GradNode *, size_t>> leaves_;
+  size_t output_row_ = 0;
+  // The lanes of every node, batch_size_ values per row.
+  std::vector<double> values_;
+  std::vector<double> grads_;
+  std::vector<double> outputs_;
+};
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // BATCH_GRAPH_H
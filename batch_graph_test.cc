@@ -0,0 +1,105 @@
+#include "batch_graph.h"
+#include "micrograd.h"
+#include "reference_expression.h"
+#include "static_graph.h"
+#include "gtest/gtest.h"
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+TEST(BatchGraphTest, MatchesStaticGraphPerSample) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto b = GradNode::CreateGradnode(-0.25, "b");
+  auto c = GradNode::CreateGradnode(3.0, "c");
+  c->MakeScalar();
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto y = GradNode::CreateGradnode(0.0, "y");
+  auto out = Sum({ReferenceExpression(Dot({w, b}, {x, y}) + w * x * c, b, y),
+                  1.0 / w, Dot({x, y}, {2.0, -1.0}), y / 2.0, 3.0 - x});
+  StaticGraph graph(out, {x, y});
+  BatchGraph batch(out, {x, y}, 4);
+
+  // Fewer samples than the batch size.
+  std::vector<std::vector<double>> samples = {
+      {-2.0, 1.5}, {0.1, 0.5}, {3.0, 2.0}};
+  double w_grad = 0.0;
+  double b_grad = 0.0;
+  std::vector<std::vector<double>> input_grads;
+  std::vector<double> values;
+  for (auto &sample : samples) {
+    w->ZeroGrad();
+    b->ZeroGrad();
+    values.push_back(graph.Forward(sample));
+    graph.Backward();
+    w_grad += w->GetGrad();
+    b_grad += b->GetGrad();
+    input_grads.push_back({x->GetGrad(), y->GetGrad()});
+  }
+
+  w->ZeroGrad();
+  b->ZeroGrad();
+  auto &outputs = batch.Forward(samples);
+  batch.Backward();
+
+  ASSERT_EQ(outputs.size(), samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    EXPECT_DOUBLE_EQ(outputs[i], values[i]);
+    EXPECT_DOUBLE_EQ(batch.InputGrad(i, 0), input_grads[i][0]);
+    EXPECT_DOUBLE_EQ(batch.InputGrad(i, 1), input_grads[i][1]);
+  }
+  EXPECT_NEAR(w->GetGrad(), w_grad, 1e-12);
+  EXPECT_NEAR(b->GetGrad(), b_grad, 1e-12);
+  EXPECT_EQ(c->GetGrad(), 0.0);
+  EXPECT_EQ(batch.Size(), graph.Size());
+}
+
+TEST(BatchGraphTest, ReadsParametersOnEveryForward) {
+  auto w = GradNode::CreateGradnode(2.0, "w");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  BatchGraph batch(w * x, {x}, 2);
+
+  EXPECT_EQ(batch.Forward({{1.0}, {3.0}}), (std::vector<double>{2.0, 6.0}));
+  batch.Backward();
+  batch.Backward();
+  EXPECT_EQ(w->GetGrad(), 8.0);
+  w->SetData(-1.0);
+  EXPECT_EQ(batch.Forward({{1.0}, {3.0}}), (std::vector<double>{-1.0, -3.0}));
+}
+
+TEST(BatchGraphTest, IgnoresUnreachedInputs) {
+  auto w = GradNode::CreateGradnode(3.0, "w");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto y = GradNode::CreateGradnode(0.0, "y");
+  BatchGraph batch(x * w, {x, y}, 2);
+
+  EXPECT_EQ(batch.Forward({{1.0, 100.0}, {2.0, 200.0}}),
+            (std::vector<double>{3.0, 6.0}));
+  batch.Backward();
+  EXPECT_EQ(batch.InputGrad(1, 0), 3.0);
+  EXPECT_EQ(batch.InputGrad(1, 1), 0.0);
+  EXPECT_EQ(w->GetGrad(), 3.0);
+}
+
+TEST(BatchGraphTest, RejectsInvalidArguments) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto custom = GradNode::CreateGradnode(4.0, "", {x}, []() {});
+  BatchGraph batch(w * x, {x}, 2);
+
+  EXPECT_THROW(BatchGraph(w * x, {x}, 0), std::invalid_argument);
+  EXPECT_THROW(BatchGraph(w * x, {w * x}, 2), std::invalid_argument);
+  EXPECT_THROW(BatchGraph(custom, {x}, 2), std::invalid_argument);
+  EXPECT_THROW(batch.Forward({}), std::invalid_argument);
+  EXPECT_THROW(batch.Forward({{1.0}, {2.0}, {3.0}}), std::invalid_argument);
+  EXPECT_THROW(batch.Forward({{1.0, 2.0}}), std::invalid_argument);
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,35 @@
+"""Compiles kernels generated by micrograd's CodeGenerator."""
+
+def micrograd_kernel(name, generator, **kwargs):
+    """Runs a generator binary and compiles the kernel it writes.
+
+    The generator is called with the paths of the header and the source file
+    to write, `<name>.h` and `<name>.cc`, as CodeGenerator::WriteFiles expects.
+
+    Args:
+      name: The name of the cc_library, and the base name of its files.
+      generator: A cc_binary that builds a graph and writes its kernel.
+      **kwargs: Further arguments of the cc_library, such as visibility.
+        testonly also applies to the generating rule.
+    """
+    native.genrule(
+        name = name + "_sources",
+        outs = [
+            name + ".h",
+            name + ".cc",
+        ],
+        cmd = "$(location %s) $(location %s.h) $(location %s.cc)" % (
+            generator,
+            name,
+            name,
+        ),
+        tools = [generator],
+        testonly = kwargs.get("testonly", False),
+    )
+    native.cc_library(
+        name = name,
+        srcs = [name + ".cc"],
+        hdrs = [name + ".h"],
+        deps = [Label("//:numeric")] + kwargs.pop("deps", []),
+        **kwargs
+    )
@@ -0,0 +1,366 @@
+#include "codegen.h"
+#include "graph.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+namespace {
+
+/// The first line of every generated file.
+constexpr char kBanner[] =
+    "// Generated by micrograd's CodeGenerator. Do not edit.\n";
+
+/// Formats a double as a C++ literal that reads back as the same value.
+std::string Literal(double value) {
+  if (std::isnan(value)) {
+    return "std::numeric_limits<double>::quiet_NaN()";
+  }
+  if (std::isinf(value)) {
+    return value > 0 ? "std::numeric_limits<double>::infinity()"
+                     : "-std::numeric_limits<double>::infinity()";
+  }
+  std::ostringstream literal;
+  literal << std::setprecision(17) << value;
+  auto text = literal.str();
+  if (text.find_first_of(".eE") == std::string::npos) {
+    text += ".0";
+  }
+  return text;
+}
+
+/// Gets the base name of a path, which the source file includes.
+std::string BaseName(const std::string &path) {
+  auto slash = path.find_last_of('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
+CodeGenerator::CodeGenerator(std::shared_ptr<GradNode> output,
+                             std::vector<std::shared_ptr<GradNode>> inputs)
+    : output_(std::move(output)), inputs_(std::move(inputs)) {
+  for (auto &input : inputs_) {
+    if (!input->children_.empty()) {
+      throw std::invalid_argument("CodeGenerator inputs must be leaf nodes");
+    }
+  }
+
+  internal::TopologicalSort(output_.get(), &order_);
+  std::unordered_map<const GradNode *, std::shared_ptr<GradNode>> owners;
+  owners[output_.get()] = output_;
+  for (auto *node : order_) {
+    for (auto &child : node->children_) {
+      owners[child.get()] = child;
+    }
+  }
+  for (size_t i = 0; i < inputs_.size(); i++) {
+    leaf_values_[inputs_[i].get()] = "inputs[" + std::to_string(i) + "]";
+  }
+
+  needs_grad_.resize(order_.size());
+  for (size_t i = 0; i < order_.size(); i++) {
+    auto *node = order_[i];
+    index_[node] = i;
+    if (node->children_.empty()) {
+      if (leaf_values_.count(node) == 0) {
+        if (node->is_scalar_) {
+          leaf_values_[node] = Literal(node->data_);
+        } else {
+          leaf_values_[node] =
+              "params[" + std::to_string(parameters_.size()) + "]";
+          parameters_.push_back(owners[node]);
+        }
+      }
+      needs_grad_[i] = !node->is_scalar_;
+      continue;
+    }
+    if (node->op_ == GradNode::Op::kCustom) {
+      throw std::invalid_argument("CodeGenerator cannot export custom nodes");
+    }
+    // GradNode passes no gradient to scalar nodes, so only the output of
+    // those takes one.
+    if (node->is_scalar_ && node != output_.get()) {
+      continue;
+    }
+    for (auto &child : node->children_) {
+      if (needs_grad_[index_[child.get()]]) {
+        needs_grad_[i] = true;
+      }
+    }
+  }
+}
+
+std::string CodeGenerator::Value(const GradNode *node) const {
+  return "v" + std::to_string(index_.at(node));
+}
+
+std::string CodeGenerator::Grad(const GradNode *node) const {
+  return "g" + std::to_string(index_.at(node));
+}
+
+bool CodeGenerator::NeedsGrad(const GradNode *node) const {
+  return needs_grad_[index_.at(node)];
+}
+
+std::string CodeGenerator::ForwardExpression(const GradNode *node) const {
+  auto &children = node->children_;
+  auto child = [&](size_t i) { return Value(children[i].get()); };
+  auto operand = Literal(node->operand_);
+  switch (node->op_) {
+  case GradNode::Op::kAdd:
+    return child(0) + " + " + child(1);
+  case GradNode::Op::kSub:
+    return child(0) + " - " + child(1);
+  case GradNode::Op::kMul:
+    return child(0) + " * " + child(1);
+  case GradNode::Op::kDiv:
+    return child(0) + " / " + child(1);
+  case GradNode::Op::kPow:
+    return "std::pow(" + child(0) + ", " + child(1) + ")";
+  case GradNode::Op::kLog:
+    return "std::log(" + child(0) + ")";
+  case GradNode::Op::kSigmoid:
+    return "internal::StableSigmoid(" + child(0) + ")";
+  case GradNode::Op::kTanh:
+    return "std::tanh(" + child(0) + ")";
+  case GradNode::Op::kRelu:
+    return "std::max(" + child(0) + ", 0.0)";
+  case GradNode::Op::kAddConstant:
+    return child(0) + " + " + operand;
+  case GradNode::Op::kSubConstant:
+    return child(0) + " - " + operand;
+  case GradNode::Op::kRSubConstant:
+    return operand + " - " + child(0);
+  case GradNode::Op::kMulConstant:
+    return child(0) + " * " + operand;
+  case GradNode::Op::kDivConstant:
+    return child(0) + " / " + operand;
+  case GradNode::Op::kRDivConstant:
+    return operand + " / " + child(0);
+  case GradNode::Op::kPowConstant:
+    return "std::pow(" + child(0) + ", " + operand + ")";
+  case GradNode::Op::kSum: {
+    auto expression = child(0);
+    for (size_t i = 1; i < children.size(); i++) {
+      expression += " + " + child(i);
+    }
+    return expression;
+  }
+  case GradNode::Op::kDot: {
+    auto n = children.size() / 2;
+    std::string expression;
+    for (size_t i = 0; i < n; i++) {
+      expression += (i > 0 ? " + " : "") + child(i) + " * " + child(n + i);
+    }
+    return expression;
+  }
+  case GradNode::Op::kDotConstant: {
+    std::string expression;
+    for (size_t i = 0; i < children.size(); i++) {
+      expression += (i > 0 ? " + " : "") + child(i) + " * " +
+                    Literal(node->operands_[i]);
+    }
+    return expression;
+  }
+  case GradNode::Op::kLeaf:
+  case GradNode::Op::kCustom:
+    break;
+  }
+  return leaf_values_.at(node);
+}
+
+void CodeGenerator::EmitForward(std::string *code) const {
+  for (auto *node : order_) {
+    *code += "  const double " + Value(node) + " = " +
+             ForwardExpression(node) + ";\n";
+  }
+}
+
+void CodeGenerator::EmitBackward(const GradNode *node,
+                                 std::string *code) const {
+  if (node->children_.empty() || !NeedsGrad(node)) {
+    return;
+  }
+  auto &children = node->children_;
+  auto g = Grad(node);
+  auto operand = Literal(node->operand_);
+  // Adds a contribution to child i, if it takes gradients.
+  auto add = [&](size_t i, const std::string &contribution) {
+    if (NeedsGrad(children[i].get())) {
+      *code += "  " + Grad(children[i].get()) + " += " + contribution + ";\n";
+    }
+  };
+  auto child = [&](size_t i) { return Value(children[i].get()); };
+  auto value = Value(node);
+  switch (node->op_) {
+  case GradNode::Op::kAdd:
+  case GradNode::Op::kSum:
+  case GradNode::Op::kAddConstant:
+  case GradNode::Op::kSubConstant:
+    for (size_t i = 0; i < children.size(); i++) {
+      add(i, g);
+    }
+    break;
+  case GradNode::Op::kSub:
+    add(0, g);
+    add(1, "-" + g);
+    break;
+  case GradNode::Op::kRSubConstant:
+    add(0, "-" + g);
+    break;
+  case GradNode::Op::kMul:
+    add(0, g + " * " + child(1));
+    add(1, g + " * " + child(0));
+    break;
+  case GradNode::Op::kDiv:
+    add(0, g + " / " + child(1));
+    add(1, "-(" + g + " * " + child(0) + " / std::pow(" + child(1) + ", 2))");
+    break;
+  case GradNode::Op::kPow:
+    add(0, g + " * " + child(1) + " * std::pow(" + child(0) + ", " +
+               child(1) + " - 1)");
+    add(1, g + " * std::pow(" + child(0) + ", " + child(1) + ") * std::log(" +
+               child(0) + ")");
+    break;
+  case GradNode::Op::kLog:
+    add(0, g + " * (1 / " + child(0) + ")");
+    break;
+  case GradNode::Op::kSigmoid:
+    add(0, g + " * " + value + " * (1.0 - " + value + ")");
+    break;
+  case GradNode::Op::kTanh:
+    add(0, g + " * (1.0 - " + value + " * " + value + ")");
+    break;
+  case GradNode::Op::kRelu:
+    add(0, "(" + child(0) + " > 0 ? " + g + " : 0.0)");
+    break;
+  case GradNode::Op::kMulConstant:
+    add(0, g + " * " + operand);
+    break;
+  case GradNode::Op::kDivConstant:
+    add(0, g + " / " + operand);
+    break;
+  case GradNode::Op::kRDivConstant:
+    add(0, "-(" + g + " * " + operand + " / std::pow(" + child(0) + ", 2))");
+    break;
+  case GradNode::Op::kPowConstant:
+    add(0, g + " * " + operand + " * std::pow(" + child(0) + ", " + operand +
+               " - 1)");
+    break;
+  case GradNode::Op::kDot: {
+    auto n = children.size() / 2;
+    for (size_t i = 0; i < n; i++) {
+      add(i, g + " * " + child(n + i));
+      add(n + i, g + " * " + child(i));
+    }
+    break;
+  }
+  case GradNode::Op::kDotConstant:
+    for (size_t i = 0; i < children.size(); i++) {
+      add(i, g + " * " + Literal(node->operands_[i]));
+    }
+    break;
+  case GradNode::Op::kLeaf:
+  case GradNode::Op::kCustom:
+    break;
+  }
+}
+
+std::string CodeGenerator::Header(const std::string &name) const {
+  std::string guard;
+  for (char c : name) {
+    guard += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+  }
+  guard += "_KERNEL_H";
+
+  std::string code = kBanner;
+  code += "#ifndef " + guard + "\n#define " + guard + "\n\n";
+  code += "namespace apexkid {\nnamespace micrograd {\nnamespace kernels {\n\n";
+  code += "// Inputs: " + std::to_string(inputs_.size()) + ".\n";
+  code += "// Parameters:";
+  for (size_t i = 0; i < parameters_.size(); i++) {
+    auto label = parameters_[i]->label_;
+    code += " " + (label.empty() ? "#" + std::to_string(i) : label);
+  }
+  code += parameters_.empty() ? " none.\n\n" : ".\n\n";
+  code += "double " + name +
+          "Forward(const double *inputs, const double *params);\n";
+  code += "double " + name +
+          "Backward(const double *inputs, const double *params,\n"
+          "    double *input_grads, double *param_grads);\n\n";
+  code += "} // namespace kernels\n} // namespace micrograd\n"
+          "} // namespace apexkid\n\n";
+  code += "#endif // " + guard + "\n";
+  return code;
+}
+
+std::string CodeGenerator::Source(const std::string &name,
+                                  const std::string &header_path) const {
+  std::string code = kBanner;
+  code += "#include \"" + header_path + "\"\n";
+  code += "#include \"numeric.h\"\n\n";
+  code += "#include <algorithm>\n#include <cmath>\n#include <limits>\n\n";
+  code += "namespace apexkid {\nnamespace micrograd {\nnamespace kernels {\n\n";
+
+  code += "double " + name +
+          "Forward([[maybe_unused]] const double *inputs,\n"
+          "    [[maybe_unused]] const double *params) {\n";
+  EmitForward(&code);
+  code += "  return " + Value(output_.get()) + ";\n}\n\n";
+
+  code += "double " + name +
+          "Backward([[maybe_unused]] const double *inputs,\n"
+          "    [[maybe_unused]] const double *params,\n"
+          "    [[maybe_unused]] double *input_grads,\n"
+          "    [[maybe_unused]] double *param_grads) {\n";
+  EmitForward(&code);
+  for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+    if (NeedsGrad(*it)) {
+      code += "  double " + Grad(*it) + " = " +
+              (*it == output_.get() ? "1.0" : "0.0") + ";\n";
+    }
+  }
+  for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+    EmitBackward(*it, &code);
+  }
+  for (size_t i = 0; i < inputs_.size(); i++) {
+    if (index_.count(inputs_[i].get()) > 0 && NeedsGrad(inputs_[i].get())) {
+      code += "  input_grads[" + std::to_string(i) +
+              "] += " + Grad(inputs_[i].get()) + ";\n";
+    }
+  }
+  for (size_t i = 0; i < parameters_.size(); i++) {
+    code += "  param_grads[" + std::to_string(i) +
+            "] += " + Grad(parameters_[i].get()) + ";\n";
+  }
+  code += "  return " + Value(output_.get()) + ";\n}\n\n";
+  code += "} // namespace kernels\n} // namespace micrograd\n"
+          "} // namespace apexkid\n";
+  return code;
+}
+
+bool CodeGenerator::WriteFiles(const std::string &name,
+                               const std::string &header_path,
+                               const std::string &source_path) const {
+  std::ofstream header(header_path);
+  header << Header(name);
+  std::ofstream source(source_path);
+  source << Source(name, BaseName(header_path));
+  return static_cast<bool>(header) && static_cast<bool>(source);
+}
+
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,119 @@
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+#include "micrograd.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+/**
+ * @class CodeGenerator
+ * @brief Exports a GradNode graph as straight-line C++ functions.
+ *
+ * Like StaticGraph, the generator captures a graph once, with leaf nodes as
+ * placeholders for the inputs. It emits a header and a source file that
+ * declare and define, in namespace apexkid::micrograd::kernels:
+ *
+ *     double NameForward(const double *inputs, const double *params);
+ *     double NameBackward(const double *inputs, const double *params,
+ *                         double *input_grads, double *param_grads);
+ *
+ * Forward returns the value of the output. Backward returns it too, and adds
+ * the gradients of the output to input_grads and param_grads. Every node
+ * becomes a local variable, so the generated code has no allocation, no
+ * std::function and no graph to traverse.
+ *
+ * Leaves other than the inputs become parameters, read from params in the
+ * order of Parameters(), unless they are marked with MakeScalar(): those are
+ * emitted as constants with their current value.
+ *
+ * The micrograd_kernel macro of codegen.bzl runs a generator binary and
+ * compiles its output into a cc_library.
+ */
+class CodeGenerator {
+public:
+  /**
+   * @brief Captures the graph computing an output.
+   * @param output The node computing the result of the graph.
+   * @param inputs The leaf nodes read from the inputs array, in order.
+   * @throws std::invalid_argument If an input is not a leaf, or the graph
+   * contains a custom node whose backward function cannot be exported.
+   */
+  CodeGenerator(std::shared_ptr<GradNode> output,
+                std::vector<std::shared_ptr<GradNode>> inputs);
+
+  /**
+   * @brief Gets the parameters of the generated functions.
+   * @return The leaves read from the params array, in order.
+   */
+  const std::vector<std::shared_ptr<GradNode>> &Parameters() const {
+    return parameters_;
+  }
+
+  /**
+   * @brief Generates the header declaring the functions.
+   * @param name The prefix of the function names, such as "LinearRegression".
+   * @return The contents of the header.
+   */
+  std::string Header(const std::string &name) const;
+
+  /**
+   * @brief Generates the source file defining the functions.
+   * @param name The prefix of the function names.
+   * @param header_path The path the source file includes the header by.
+   * @return The contents of the source file.
+   */
+  std::string Source(const std::string &name,
+                     const std::string &header_path) const;
+
+  /**
+   * @brief Writes Header() and Source() to files.
+   * @param name The prefix of the function names.
+   * @param header_path The file to write the header to, which the source
+   * file includes by its base name.
+   * @param source_path The file to write the source file to.
+   * @return True if both files were written.
+   */
+  bool WriteFiles(const std::string &name, const std::string &header_path,
+                  const std::string &source_path) const;
+
+private:
+  /// The name of the variable holding the value of a node.
+  std::string Value(const GradNode *node) const;
+
+  /// The name of the variable holding the gradient of a node.
+  std::string Grad(const GradNode *node) const;
+
+  /// Whether a gradient flows into a node.
+  bool NeedsGrad(const GradNode *node) const;
+
+  /// The expression computing the value of a node.
+  std::string ForwardExpression(const GradNode *node) const;
+
+  /// Emits the statements computing the value of every node.
+  void EmitForward(std::string *code) const;
+
+  /// Emits the statements passing the gradient of a node to its children.
+  void EmitBackward(const GradNode *node, std::string *code) const;
+
+  std::shared_ptr<GradNode> output_;              // Keeps the graph alive.
+  std::vector<std::shared_ptr<GradNode>> inputs_; // Placeholder leaves.
+  std::vector<std::shared_ptr<GradNode>> parameters_;
+  // Every node with every child before its parents, so the output comes last.
+  std::vector<GradNode *> order_;
+  // Position of each node in order_, which names its variables.
+  std::unordered_map<const GradNode *, size_t> index_;
+  // Where each leaf is read from: "inputs[i]", "params[i]" or a constant.
+  std::unordered_map<const GradNode *, std::string> leaf_values_;
+  std::vector<bool> needs_grad_; // Indexed like order_.
+};
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // CODEGEN_H
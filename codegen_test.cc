@@ -0,0 +1,115 @@
+#include "codegen.h"
+#include "linear_regression_kernel.h"
+#include "micrograd.h"
+#include "scalar_node_kernel.h"
+#include "static_graph.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+TEST(CodeGeneratorTest, GeneratesStraightLineFunctions) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto c = GradNode::CreateGradnode(2.0, "c");
+  c->MakeScalar();
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto z = w * x + c;
+  CodeGenerator generator(sigmoid(z), {x});
+
+  auto header = generator.Header("Model");
+  auto source = generator.Source("Model", "model.h");
+
+  EXPECT_NE(header.find("double ModelForward("), std::string::npos);
+  EXPECT_NE(header.find("double ModelBackward("), std::string::npos);
+  EXPECT_NE(source.find("#include \"model.h\""), std::string::npos);
+  EXPECT_EQ(source.find("shared_ptr"), std::string::npos);
+  EXPECT_EQ(source.find("std::function"), std::string::npos);
+  // The scalar is a constant of the kernel rather than a parameter.
+  ASSERT_EQ(generator.Parameters().size(), 1);
+  EXPECT_EQ(generator.Parameters()[0], w);
+  EXPECT_NE(source.find("2.0"), std::string::npos);
+}
+
+TEST(CodeGeneratorTest, RejectsUnexportableGraphs) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto custom = GradNode::CreateGradnode(4.0, "", {x}, []() {});
+
+  EXPECT_THROW(CodeGenerator(w * x, {w * x}), std::invalid_argument);
+  EXPECT_THROW(CodeGenerator(custom, {x}), std::invalid_argument);
+}
+
+// linear_regression_kernel is generated at build time by
+// linear_regression_kernel_generator.
+TEST(CodeGeneratorTest, GeneratedKernelMatchesStaticGraph) {
+  auto w1 = GradNode::CreateGradnode(0.5, "w1");
+  auto w2 = GradNode::CreateGradnode(-1.5, "w2");
+  auto w3 = GradNode::CreateGradnode(2.0, "w3");
+  auto b = GradNode::CreateGradnode(0.25, "b");
+  auto x1 = GradNode::CreateGradnode(0.0, "x1");
+  auto x2 = GradNode::CreateGradnode(0.0, "x2");
+  auto x3 = GradNode::CreateGradnode(0.0, "x3");
+  auto y = GradNode::CreateGradnode(0.0, "y");
+  auto pred = Dot({w1, w2, w3}, {x1, x2, x3}) + b;
+  auto diff = pred - y;
+  StaticGraph graph(pow(diff, 2), {x1, x2, x3, y});
+
+  std::vector<std::shared_ptr<GradNode>> params = {w1, w2, w3, b};
+  std::vector<std::shared_ptr<GradNode>> inputs = {x1, x2, x3, y};
+  double param_values[] = {0.5, -1.5, 2.0, 0.25};
+  for (auto sample : {std::vector<double>{1.0, 2.0, 3.0, 4.0},
+                      std::vector<double>{-0.5, 0.0, 0.75, -2.0}}) {
+    for (auto &param : params) {
+      param->ZeroGrad();
+    }
+    auto value = graph.Forward(sample);
+    graph.Backward();
+
+    double input_grads[4] = {};
+    double param_grads[4] = {};
+    EXPECT_DOUBLE_EQ(
+        kernels::LinearRegressionLossForward(sample.data(), param_values),
+        value);
+    EXPECT_DOUBLE_EQ(kernels::LinearRegressionLossBackward(
+                         sample.data(), param_values, input_grads, param_grads),
+                     value);
+    for (size_t i = 0; i < 4; i++) {
+      EXPECT_DOUBLE_EQ(input_grads[i], inputs[i]->GetGrad());
+      EXPECT_DOUBLE_EQ(param_grads[i], params[i]->GetGrad());
+    }
+  }
+}
+
+// scalar_node_kernel is generated by scalar_node_kernel_generator from
+// t*w + x with t = w*2 marked as a scalar.
+TEST(CodeGeneratorTest, ScalarNodesTakeNoGradient) {
+  auto w = GradNode::CreateGradnode(3.0, "w");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto t = w * 2.0;
+  t->MakeScalar();
+  StaticGraph graph(t * w + x, {x});
+
+  double sample[] = {1.0};
+  double param_values[] = {3.0};
+  double input_grads[1] = {};
+  double param_grads[1] = {};
+  auto value = graph.Forward({sample[0]});
+  graph.Backward();
+
+  EXPECT_DOUBLE_EQ(kernels::ScalarNodeBackward(sample, param_values,
+                                               input_grads, param_grads),
+                   value);
+  EXPECT_DOUBLE_EQ(param_grads[0], w->GetGrad());
+  EXPECT_DOUBLE_EQ(param_grads[0], 6.0);
+  EXPECT_DOUBLE_EQ(input_grads[0], x->GetGrad());
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
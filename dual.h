@@ -0,0 +1,207 @@
+#ifndef DUAL_H
+#define DUAL_H
+
+#include "numeric.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace apexkid {
+namespace micrograd {
+
+/**
+ * @class Dual
+ * @brief A value with N tangents, for forward-mode differentiation.
+ *
+ * Each tangent lane carries the derivative of the value along one input
+ * direction, and every operator updates all N lanes with the chain rule as it
+ * computes the value. Seeding lane i of input i with 1 gives the N partial
+ * derivatives of a function of N inputs in one forward pass; seeding the
+ * inputs with a direction v gives the Jacobian-vector product J v.
+ *
+ * Unlike GradNode::Backward(), nothing is recorded, sorted or allocated, which
+ * makes forward mode the cheaper choice for functions of few inputs. For many
+ * inputs and one output, reverse mode computes the gradient at a fraction of
+ * the cost of N lanes.
+ *
+ * @tparam N The number of tangent lanes.
+ */
+template <size_t N> class Dual {
+public:
+  using Tangent = std::array<double, N>;
+
+  /**
+   * @brief Constructs a constant: a value with all tangents zero.
+   * @param data The value.
+   */
+  Dual(double data = 0.0) : data_(data), tangent_{} {}
+
+  /**
+   * @brief Constructs a value with the given tangents.
+   * @param data The value.
+   * @param tangent The derivative of the value along each lane.
+   */
+  Dual(double data, const Tangent &tangent) : data_(data), tangent_(tangent) {}
+
+  /**
+   * @brief Creates an input differentiated along one lane.
+   * @param data The value of the input.
+   * @param lane The lane whose tangent is seeded with 1.
+   * @return The input.
+   */
+  static Dual Variable(double data, size_t lane) {
+    Dual x(data);
+    x.tangent_[lane] = 1.0;
+    return x;
+  }
+
+  /**
+   * @brief Gets the value.
+   * @return The value.
+   */
+  double GetData() const { return data_; }
+
+  /**
+   * @brief Gets the derivative along one lane.
+   * @param lane The lane.
+   * @return The tangent of that lane.
+   */
+  double GetTangent(size_t lane) const { return tangent_[lane]; }
+
+  /**
+   * @brief Gets the derivatives along all lanes.
+   * @return The tangents.
+   */
+  const Tangent &GetTangents() const { return tangent_; }
+
+  /**
+   * @brief Applies the chain rule for a function of one argument.
+   * @param data The value of f(x).
+   * @param derivative The value of f'(x).
+   * @param x The argument.
+   * @return f(x) with the tangents of x scaled by f'(x).
+   */
+  static Dual Chain(double data, double derivative, const Dual &x) {
+    Dual result(data);
+    for (size_t i = 0; i < N; i++) {
+      result.tangent_[i] = derivative * x.tangent_[i];
+    }
+    return result;
+  }
+
+  /**
+   * @brief Applies the chain rule for a function of two arguments.
+   * @param data The value of f(a, b).
+   * @param da The partial derivative of f along a.
+   * @param a The first argument.
+   * @param db The partial derivative of f along b.
+   * @param b The second argument.
+   * @return f(a, b) with the combined tangents of a and b.
+   */
+  static Dual Chain(double data, double da, const Dual &a, double db,
+                    const Dual &b) {
+    Dual result(data);
+    for (size_t i = 0; i < N; i++) {
+      result.tangent_[i] = da * a.tangent_[i] + db * b.tangent_[i];
+    }
+    return result;
+  }
+
+private:
+  double data_;
+  Tangent tangent_;
+};
+
+// Operators. A double mixed into an expression converts to a constant Dual.
+
+template <size_t N> Dual<N> operator+(const Dual<N> &a, const Dual<N> &b) {
+  return Dual<N>::Chain(a.GetData() + b.GetData(), 1.0, a, 1.0, b);
+}
+template <size_t N> Dual<N> operator+(const Dual<N> &a, double b) {
+  return Dual<N>::Chain(a.GetData() + b, 1.0, a);
+}
+template <size_t N> Dual<N> operator+(double a, const Dual<N> &b) {
+  return Dual<N>::Chain(a + b.GetData(), 1.0, b);
+}
+
+template <size_t N> Dual<N> operator-(const Dual<N> &a, const Dual<N> &b) {
+  return Dual<N>::Chain(a.GetData() - b.GetData(), 1.0, a, -1.0, b);
+}
+template <size_t N> Dual<N> operator-(const Dual<N> &a, double b) {
+  return Dual<N>::Chain(a.GetData() - b, 1.0, a);
+}
+template <size_t N> Dual<N> operator-(double a, const Dual<N> &b) {
+  return Dual<N>::Chain(a - b.GetData(), -1.0, b);
+}
+
+template <size_t N> Dual<N> operator*(const Dual<N> &a, const Dual<N> &b) {
+  return Dual<N>::Chain(a.GetData() * b.GetData(), b.GetData(), a,
+                        a.GetData(), b);
+}
+template <size_t N> Dual<N> operator*(const Dual<N> &a, double b) {
+  return Dual<N>::Chain(a.GetData() * b, b, a);
+}
+template <size_t N> Dual<N> operator*(double a, const Dual<N> &b) {
+  return Dual<N>::Chain(a * b.GetData(), a, b);
+}
+
+template <size_t N> Dual<N> operator/(const Dual<N> &a, const Dual<N> &b) {
+  auto data = a.GetData() / b.GetData();
+  return Dual<N>::Chain(data, 1.0 / b.GetData(), a, -data / b.GetData(), b);
+}
+template <size_t N> Dual<N> operator/(const Dual<N> &a, double b) {
+  return Dual<N>::Chain(a.GetData() / b, 1.0 / b, a);
+}
+template <size_t N> Dual<N> operator/(double a, const Dual<N> &b) {
+  auto data = a / b.GetData();
+  return Dual<N>::Chain(data, -data / b.GetData(), b);
+}
+
+template <size_t N> Dual<N> pow(const Dual<N> &base, double exponent) {
+  return Dual<N>::Chain(
+      std::pow(base.GetData(), exponent),
+      exponent * std::pow(base.GetData(), exponent - 1), base);
+}
+template <size_t N>
+Dual<N> pow(const Dual<N> &base, const Dual<N> &exponent) {
+  auto data = std::pow(base.GetData(), exponent.GetData());
+  auto d_base =
+      exponent.GetData() * std::pow(base.GetData(), exponent.GetData() - 1);
+  // log(base) is NaN or infinite for a base <= 0. Only lanes along which the
+  // exponent varies use it, so a constant exponent keeps them finite.
+  auto d_exponent = data * std::log(base.GetData());
+  typename Dual<N>::Tangent tangent;
+  for (size_t i = 0; i < N; i++) {
+    tangent[i] = d_base * base.GetTangent(i);
+    if (exponent.GetTangent(i) != 0.0) {
+      tangent[i] += d_exponent * exponent.GetTangent(i);
+    }
+  }
+  return Dual<N>(data, tangent);
+}
+
+template <size_t N> Dual<N> log(const Dual<N> &x) {
+  return Dual<N>::Chain(std::log(x.GetData()), 1.0 / x.GetData(), x);
+}
+
+template <size_t N> Dual<N> sigmoid(const Dual<N> &x) {
+  auto data = internal::StableSigmoid(x.GetData());
+  return Dual<N>::Chain(data, data * (1.0 - data), x);
+}
+
+template <size_t N> Dual<N> tanh(const Dual<N> &x) {
+  auto data = std::tanh(x.GetData());
+  return Dual<N>::Chain(data, 1.0 - data * data, x);
+}
+
+template <size_t N> Dual<N> relu(const Dual<N> &x) {
+  return Dual<N>::Chain(std::max(x.GetData(), 0.0),
+                        x.GetData() > 0 ? 1.0 : 0.0, x);
+}
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // DUAL_H
@@ -0,0 +1,82 @@
+#include "dual.h"
+#include "micrograd.h"
+#include "reference_expression.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+// Z = (A + A + A)^2 + (3*A)
+TEST(DualTest, SingleVariable) {
+  auto a = Dual<1>::Variable(2.0, 0);
+  auto b = a + a + a;
+
+  auto z = pow(b, 2) + (3 * a);
+
+  EXPECT_EQ(z.GetData(), 42.0);
+  EXPECT_EQ(z.GetTangent(0), 39.0);
+}
+
+TEST(DualTest, MatchesGradNode) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto b = GradNode::CreateGradnode(-0.25, "b");
+  auto e = GradNode::CreateGradnode(1.5, "e");
+  auto out = ReferenceExpression(w, b, e);
+  out->Backward();
+
+  auto out_dual = ReferenceExpression(Dual<3>::Variable(0.5, 0),
+                                      Dual<3>::Variable(-0.25, 1),
+                                      Dual<3>::Variable(1.5, 2));
+
+  EXPECT_NEAR(out_dual.GetData(), out->GetData(), 1e-12);
+  EXPECT_NEAR(out_dual.GetTangent(0), w->GetGrad(), 1e-12);
+  EXPECT_NEAR(out_dual.GetTangent(1), b->GetGrad(), 1e-12);
+  EXPECT_NEAR(out_dual.GetTangent(2), e->GetGrad(), 1e-12);
+}
+
+// f(x, y) = (x * y, x / y) has the Jacobian [[y, x], [1 / y, -x / y^2]].
+TEST(DualTest, JacobianVectorProduct) {
+  Dual<1> x(3.0, {1.0});
+  Dual<1> y(2.0, {-2.0});
+
+  auto product = x * y;
+  auto quotient = x / y;
+
+  EXPECT_DOUBLE_EQ(product.GetTangent(0), 2.0 * 1.0 + 3.0 * -2.0);
+  EXPECT_DOUBLE_EQ(quotient.GetTangent(0), 1.0 / 2.0 - 3.0 / 4.0 * -2.0);
+}
+
+TEST(DualTest, ConstantsHaveNoTangent) {
+  auto x = Dual<2>::Variable(4.0, 1);
+  Dual<2> c = 5.0;
+
+  auto z = c * x - c;
+
+  EXPECT_EQ(z.GetData(), 15.0);
+  EXPECT_EQ(z.GetTangent(0), 0.0);
+  EXPECT_EQ(z.GetTangent(1), 5.0);
+}
+
+// A constant exponent differentiates a non-positive base, where log(base)
+// is not finite.
+TEST(DualTest, PowOfNonPositiveBase) {
+  auto x = Dual<2>::Variable(-2.0, 0);
+  auto zero = Dual<2>::Variable(0.0, 1);
+
+  auto z = pow(x, Dual<2>(2.0));
+  auto cube = pow(zero, Dual<2>(3.0));
+
+  EXPECT_EQ(z.GetData(), 4.0);
+  EXPECT_EQ(z.GetTangent(0), -4.0);
+  EXPECT_EQ(z.GetTangent(1), 0.0);
+  EXPECT_EQ(cube.GetData(), 0.0);
+  EXPECT_EQ(cube.GetTangent(0), 0.0);
+  EXPECT_EQ(cube.GetTangent(1), 0.0);
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,338 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include "numeric.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace apexkid {
+namespace micrograd {
+namespace expr {
+
+/**
+ * @class Expression
+ * @brief Base of the expression templates: a formula whose shape is part of
+ * its type.
+ *
+ * The operators below mirror those of micrograd.h, but instead of allocating
+ * a GradNode per operation they return small value types such as
+ * Mul<Variable<0>, Constant>, which hold their operands and their own value.
+ * Evaluation happens as the expression is built, and Gradient() walks the
+ * operand tree with inlined calls, so a fixed formula compiles down to
+ * straight-line code with no heap allocation.
+ *
+ * Operands are held by value, so a subexpression used twice is stored and
+ * differentiated twice. This suits the small per-sample losses this is meant
+ * for; large or shared graphs belong in GradNode or the tape.
+ *
+ * @tparam E The derived expression type.
+ */
+template <typename E> class Expression {
+public:
+  /**
+   * @brief Gets the value of the expression.
+   * @return The value.
+   */
+  double Value() const { return Derived().value_; }
+
+  /**
+   * @brief Computes the gradient of the expression with respect to each
+   * variable.
+   * @return The partial derivatives, indexed by variable.
+   */
+  auto Gradient() const {
+    std::array<double, E::kNumVariables> grads{};
+    Derived().Backward(1.0, grads.data());
+    return grads;
+  }
+
+  /**
+   * @brief Adds the gradient of the expression to an existing gradient, for
+   * example to sum a loss over a batch.
+   * @param grads The gradient to add to, indexed by variable.
+   */
+  template <size_t N>
+  void AccumulateGradient(std::array<double, N> *grads) const {
+    static_assert(N >= E::kNumVariables,
+                  "The gradient has fewer entries than the variables");
+    Derived().Backward(1.0, grads->data());
+  }
+
+  const E &Derived() const { return static_cast<const E &>(*this); }
+};
+
+/**
+ * @class Variable
+ * @brief An input of an expression, differentiated into slot I of the
+ * gradient.
+ *
+ * Using the same index twice refers to the same variable, and their
+ * contributions add up.
+ */
+template <size_t I> class Variable : public Expression<Variable<I>> {
+public:
+  static constexpr size_t kNumVariables = I + 1;
+
+  explicit Variable(double value) : value_(value) {}
+
+  void Backward(double adjoint, double *grads) const { grads[I] += adjoint; }
+
+  double value_;
+};
+
+/**
+ * @class Constant
+ * @brief A value that is not differentiated, such as a sample's input.
+ */
+class Constant : public Expression<Constant> {
+public:
+  static constexpr size_t kNumVariables = 0;
+
+  explicit Constant(double value) : value_(value) {}
+
+  void Backward(double, double *) const {}
+
+  double value_;
+};
+
+namespace internal {
+
+constexpr size_t MaxVariables(size_t a, size_t b) { return a > b ? a : b; }
+
+} // namespace internal
+
+/// Base of the operations on two expressions.
+template <typename E, typename A, typename B>
+class BinaryExpression : public Expression<E> {
+public:
+  static constexpr size_t kNumVariables =
+      internal::MaxVariables(A::kNumVariables, B::kNumVariables);
+
+  BinaryExpression(const A &a, const B &b, double value)
+      : a_(a), b_(b), value_(value) {}
+
+  A a_;
+  B b_;
+  double value_;
+};
+
+/// Base of the operations on one expression.
+template <typename E, typename A> class UnaryExpression : public Expression<E> {
+public:
+  static constexpr size_t kNumVariables = A::kNumVariables;
+
+  UnaryExpression(const A &a, double value) : a_(a), value_(value) {}
+
+  A a_;
+  double value_;
+};
+
+template <typename A, typename B>
+class Add : public BinaryExpression<Add<A, B>, A, B> {
+public:
+  Add(const A &a, const B &b)
+      : BinaryExpression<Add, A, B>(a, b, a.value_ + b.value_) {}
+
+  void Backward(double adjoint, double *grads) const {
+    this->a_.Backward(adjoint, grads);
+    this->b_.Backward(adjoint, grads);
+  }
+};
+
+template <typename A, typename B>
+class Sub : public BinaryExpression<Sub<A, B>, A, B> {
+public:
+  Sub(const A &a, const B &b)
+      : BinaryExpression<Sub, A, B>(a, b, a.value_ - b.value_) {}
+
+  void Backward(double adjoint, double *grads) const {
+    this->a_.Backward(adjoint, grads);
+    this->b_.Backward(-adjoint, grads);
+  }
+};
+
+template <typename A, typename B>
+class Mul : public BinaryExpression<Mul<A, B>, A, B> {
+public:
+  Mul(const A &a, const B &b)
+      : BinaryExpression<Mul, A, B>(a, b, a.value_ * b.value_) {}
+
+  void Backward(double adjoint, double *grads) const {
+    this->a_.Backward(adjoint * this->b_.value_, grads);
+    this->b_.Backward(adjoint * this->a_.value_, grads);
+  }
+};
+
+template <typename A, typename B>
+class Div : public BinaryExpression<Div<A, B>, A, B> {
+public:
+  Div(const A &a, const B &b)
+      : BinaryExpression<Div, A, B>(a, b, a.value_ / b.value_) {}
+
+  void Backward(double adjoint, double *grads) const {
+    this->a_.Backward(adjoint / this->b_.value_, grads);
+    this->b_.Backward(-adjoint * this->value_ / this->b_.value_, grads);
+  }
+};
+
+template <typename A, typename B>
+class Pow : public BinaryExpression<Pow<A, B>, A, B> {
+public:
+  Pow(const A &a, const B &b)
+      : BinaryExpression<Pow, A, B>(a, b, std::pow(a.value_, b.value_)) {}
+
+  void Backward(double adjoint, double *grads) const {
+    auto base = this->a_.value_;
+    auto exponent = this->b_.value_;
+    this->a_.Backward(adjoint * exponent * std::pow(base, exponent - 1),
+                      grads);
+    this->b_.Backward(adjoint * this->value_ * std::log(base), grads);
+  }
+};
+
+/// x ^ c for a constant c, which skips the log(x) of the general case.
+template <typename A>
+class PowConstant : public UnaryExpression<PowConstant<A>, A> {
+public:
+  PowConstant(const A &a, double exponent)
+      : UnaryExpression<PowConstant, A>(a, std::pow(a.value_, exponent)),
+        exponent_(exponent) {}
+
+  void Backward(double adjoint, double *grads) const {
+    this->a_.Backward(
+        adjoint * exponent_ * std::pow(this->a_.value_, exponent_ - 1), grads);
+  }
+
+  double exponent_;
+};
+
+template <typename A> class Log : public UnaryExpression<Log<A>, A> {
+public:
+  explicit Log(const A &a)
+      : UnaryExpression<Log, A>(a, std::log(a.value_)) {}
+
+  void Backward(double adjoint, double *grads) const {
+    this->a_.Backward(adjoint / this->a_.value_, grads);
+  }
+};
+
+template <typename A> class Sigmoid : public UnaryExpression<Sigmoid<A>, A> {
+public:
+  explicit Sigmoid(const A &a)
+      : UnaryExpression<Sigmoid, A>(
+            a, micrograd::internal::StableSigmoid(a.value_)) {}
+
+  void Backward(double adjoint, double *grads) const {
+    this->a_.Backward(adjoint * this->value_ * (1.0 - this->value_), grads);
+  }
+};
+
+template <typename A> class Tanh : public UnaryExpression<Tanh<A>, A> {
+public:
+  explicit Tanh(const A &a)
+      : UnaryExpression<Tanh, A>(a, std::tanh(a.value_)) {}
+
+  void Backward(double adjoint, double *grads) const {
+    this->a_.Backward(adjoint * (1.0 - this->value_ * this->value_), grads);
+  }
+};
+
+template <typename A> class Relu : public UnaryExpression<Relu<A>, A> {
+public:
+  explicit Relu(const A &a)
+      : UnaryExpression<Relu, A>(a, std::max(a.value_, 0.0)) {}
+
+  void Backward(double adjoint, double *grads) const {
+    if (this->a_.value_ > 0) {
+      this->a_.Backward(adjoint, grads);
+    }
+  }
+};
+
+// Operators. Doubles mixed into an expression become Constants.
+
+template <typename A, typename B>
+Add<A, B> operator+(const Expression<A> &a, const Expression<B> &b) {
+  return Add<A, B>(a.Derived(), b.Derived());
+}
+template <typename A>
+Add<A, Constant> operator+(const Expression<A> &a, double b) {
+  return Add<A, Constant>(a.Derived(), Constant(b));
+}
+template <typename B>
+Add<Constant, B> operator+(double a, const Expression<B> &b) {
+  return Add<Constant, B>(Constant(a), b.Derived());
+}
+
+template <typename A, typename B>
+Sub<A, B> operator-(const Expression<A> &a, const Expression<B> &b) {
+  return Sub<A, B>(a.Derived(), b.Derived());
+}
+template <typename A>
+Sub<A, Constant> operator-(const Expression<A> &a, double b) {
+  return Sub<A, Constant>(a.Derived(), Constant(b));
+}
+template <typename B>
+Sub<Constant, B> operator-(double a, const Expression<B> &b) {
+  return Sub<Constant, B>(Constant(a), b.Derived());
+}
+
+template <typename A, typename B>
+Mul<A, B> operator*(const Expression<A> &a, const Expression<B> &b) {
+  return Mul<A, B>(a.Derived(), b.Derived());
+}
+template <typename A>
+Mul<A, Constant> operator*(const Expression<A> &a, double b) {
+  return Mul<A, Constant>(a.Derived(), Constant(b));
+}
+template <typename B>
+Mul<Constant, B> operator*(double a, const Expression<B> &b) {
+  return Mul<Constant, B>(Constant(a), b.Derived());
+}
+
+template <typename A, typename B>
+Div<A, B> operator/(const Expression<A> &a, const Expression<B> &b) {
+  return Div<A, B>(a.Derived(), b.Derived());
+}
+template <typename A>
+Div<A, Constant> operator/(const Expression<A> &a, double b) {
+  return Div<A, Constant>(a.Derived(), Constant(b));
+}
+template <typename B>
+Div<Constant, B> operator/(double a, const Expression<B> &b) {
+  return Div<Constant, B>(Constant(a), b.Derived());
+}
+
+template <typename A, typename B>
+Pow<A, B> pow(const Expression<A> &base, const Expression<B> &exponent) {
+  return Pow<A, B>(base.Derived(), exponent.Derived());
+}
+template <typename A>
+PowConstant<A> pow(const Expression<A> &base, double exponent) {
+  return PowConstant<A>(base.Derived(), exponent);
+}
+
+template <typename A> Log<A> log(const Expression<A> &x) {
+  return Log<A>(x.Derived());
+}
+
+template <typename A> Sigmoid<A> sigmoid(const Expression<A> &x) {
+  return Sigmoid<A>(x.Derived());
+}
+
+template <typename A> Tanh<A> tanh(const Expression<A> &x) {
+  return Tanh<A>(x.Derived());
+}
+
+template <typename A> Relu<A> relu(const Expression<A> &x) {
+  return Relu<A>(x.Derived());
+}
+
+} // namespace expr
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // EXPRESSION_H
@@ -0,0 +1,78 @@
+#include "expression.h"
+#include "micrograd.h"
+#include "reference_expression.h"
+#include "gtest/gtest.h"
+
+#include <array>
+#include <cmath>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+TEST(ExpressionTest, ValueAndGradient) {
+  expr::Variable<0> a(2.0);
+  expr::Variable<1> b(4.0);
+  expr::Variable<2> c(8.0);
+
+  // Z = ((pow(A, 2) * B) + A) / C
+  auto z = ((pow(a, 2.0) * b) + a) / c;
+  auto grads = z.Gradient();
+
+  EXPECT_EQ(grads.size(), 3);
+  EXPECT_DOUBLE_EQ(z.Value(), 18.0 / 8.0);
+  EXPECT_DOUBLE_EQ(grads[0], (2 * 2.0 * 4.0 + 1) / 8.0);
+  EXPECT_DOUBLE_EQ(grads[1], 4.0 / 8.0);
+  EXPECT_DOUBLE_EQ(grads[2], -18.0 / 64.0);
+}
+
+TEST(ExpressionTest, MatchesGradNode) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto b = GradNode::CreateGradnode(-0.25, "b");
+  auto e = GradNode::CreateGradnode(1.5, "e");
+  auto out = ReferenceExpression(w, b, e);
+  out->Backward();
+
+  expr::Variable<0> w_expr(0.5);
+  expr::Variable<1> b_expr(-0.25);
+  expr::Variable<2> e_expr(1.5);
+  auto out_expr = ReferenceExpression(w_expr, b_expr, e_expr);
+  auto grads = out_expr.Gradient();
+
+  EXPECT_NEAR(out_expr.Value(), out->GetData(), 1e-12);
+  EXPECT_NEAR(grads[0], w->GetGrad(), 1e-12);
+  EXPECT_NEAR(grads[1], b->GetGrad(), 1e-12);
+  EXPECT_NEAR(grads[2], e->GetGrad(), 1e-12);
+}
+
+TEST(ExpressionTest, RepeatedVariablesAccumulate) {
+  expr::Variable<1> x(3.0);
+
+  auto y = x * x + x;
+  auto grads = y.Gradient();
+
+  EXPECT_EQ(grads.size(), 2);
+  EXPECT_DOUBLE_EQ(y.Value(), 12.0);
+  EXPECT_DOUBLE_EQ(grads[0], 0.0);
+  EXPECT_DOUBLE_EQ(grads[1], 7.0);
+}
+
+TEST(ExpressionTest, AccumulateGradientOverBatch) {
+  const double xs[] = {1.0, 2.0, 3.0};
+  const double ys[] = {2.0, 3.0, 7.0};
+  std::array<double, 2> grads{};
+  for (int i = 0; i < 3; i++) {
+    expr::Variable<0> w(2.0);
+    expr::Variable<1> b(0.5);
+    auto loss = pow(w * xs[i] + b - ys[i], 2);
+    loss.AccumulateGradient(&grads);
+  }
+
+  // d/dw sum (w x + b - y)^2 = sum 2 (w x + b - y) x, and likewise for b.
+  EXPECT_DOUBLE_EQ(grads[0], 2 * (0.5 * 1 + 1.5 * 2 + -0.5 * 3));
+  EXPECT_DOUBLE_EQ(grads[1], 2 * (0.5 + 1.5 + -0.5));
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,234 @@
+#include "gradient_graph.h"
+#include "graph.h"
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+namespace {
+
+/// Creates a constant node, which later backward passes skip.
+std::shared_ptr<GradNode> Constant(double value) {
+  auto node = GradNode::CreateGradnode(value, "");
+  node->MakeScalar();
+  return node;
+}
+
+} // namespace
+
+GradientGraph::GradientGraph(
+    const std::shared_ptr<GradNode> &output,
+    const std::vector<std::shared_ptr<GradNode>> &inputs) {
+  // The gradients are graphs themselves, also under a NoGradGuard.
+  EnableGradGuard enable_grad;
+  std::vector<GradNode *> order;
+  internal::TopologicalSort(output.get(), &order);
+  adjoints_[output.get()] = {output, Constant(1.0)};
+  // Parents come before their children in reverse order, so a node has
+  // received every contribution to its gradient by the time it is visited.
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    auto found = adjoints_.find(*it);
+    if (found == adjoints_.end()) {
+      continue;
+    }
+    auto adjoint = found->second;
+    Propagate(adjoint.node, adjoint.grad);
+  }
+
+  gradients_.reserve(inputs.size());
+  for (auto &input : inputs) {
+    auto found = adjoints_.find(input.get());
+    gradients_.push_back(found != adjoints_.end() ? found->second.grad
+                                                  : Constant(0.0));
+  }
+  adjoints_.clear();
+}
+
+void GradientGraph::Accumulate(const std::shared_ptr<GradNode> &node,
+                               std::shared_ptr<GradNode> contribution) {
+  auto &adjoint = adjoints_[node.get()];
+  if (adjoint.grad == nullptr) {
+    adjoint = {node, std::move(contribution)};
+  } else {
+    adjoint.grad = adjoint.grad + contribution;
+  }
+}
+
+void GradientGraph::Propagate(const std::shared_ptr<GradNode> &node,
+                              std::shared_ptr<GradNode> grad) {
+  auto &children = node->children_;
+  switch (node->op_) {
+  case GradNode::Op::kLeaf:
+    break;
+  case GradNode::Op::kCustom:
+    if (!children.empty()) {
+      throw std::invalid_argument(
+          "GradientGraph cannot differentiate custom nodes");
+    }
+    break;
+  case GradNode::Op::kAdd:
+  case GradNode::Op::kSum:
+    for (auto &child : children) {
+      if (!child->is_scalar_) {
+        Accumulate(child, grad);
+      }
+    }
+    break;
+  case GradNode::Op::kSub:
+    if (!children[0]->is_scalar_) {
+      Accumulate(children[0], grad);
+    }
+    if (!children[1]->is_scalar_) {
+      Accumulate(children[1], 0.0 - grad);
+    }
+    break;
+  case GradNode::Op::kMul:
+    if (!children[0]->is_scalar_) {
+      Accumulate(children[0], grad * children[1]);
+    }
+    if (!children[1]->is_scalar_) {
+      Accumulate(children[1], grad * children[0]);
+    }
+    break;
+  case GradNode::Op::kDiv:
+    if (!children[0]->is_scalar_) {
+      Accumulate(children[0], grad / children[1]);
+    }
+    if (!children[1]->is_scalar_) {
+      Accumulate(children[1], 0.0 - grad * node / children[1]);
+    }
+    break;
+  case GradNode::Op::kPow: {
+    auto base = children[0];
+    auto exponent = children[1];
+    if (!base->is_scalar_) {
+      auto exponent_minus_one = exponent - 1.0;
+      Accumulate(base, grad * exponent * pow(base, exponent_minus_one));
+    }
+    if (!exponent->is_scalar_) {
+      Accumulate(exponent, grad * node * log(base));
+    }
+    break;
+  }
+  case GradNode::Op::kLog:
+    if (!children[0]->is_scalar_) {
+      Accumulate(children[0], grad / children[0]);
+    }
+    break;
+  case GradNode::Op::kSigmoid:
+    if (!children[0]->is_scalar_) {
+      Accumulate(children[0], grad * node * (1.0 - node));
+    }
+    break;
+  case GradNode::Op::kTanh:
+    if (!children[0]->is_scalar_) {
+      Accumulate(children[0], grad * (1.0 - node * node));
+    }
+    break;
+  case GradNode::Op::kRelu:
+    // The derivative is a step, which is constant wherever it is defined.
+    if (!children[0]->is_scalar_ && children[0]->data_ > 0) {
+      Accumulate(children[0], grad);
+    }
+    break;
+  case GradNode::Op::kAddConstant:
+  case GradNode::Op::kSubConstant:
+    if (!children[0]->is_scalar_) {
+      Accumulate(children[0], grad);
+    }
+    break;
+  case GradNode::Op::kRSubConstant:
+    if (!children[0]->is_scalar_) {
+      Accumulate(children[0], 0.0 - grad);
+    }
+    break;
+  case GradNode::Op::kMulConstant:
+    if (!children[0]->is_scalar_) {
+      Accumulate(children[0], grad * node->operand_);
+    }
+    break;
+  case GradNode::Op::kDivConstant:
+    if (!children[0]->is_scalar_) {
+      Accumulate(children[0], grad / node->operand_);
+    }
+    break;
+  case GradNode::Op::kRDivConstant:
+    // d(c / x)/dx = -(c / x) / x.
+    if (!children[0]->is_scalar_) {
+      Accumulate(children[0], 0.0 - grad * node / children[0]);
+    }
+    break;
+  case GradNode::Op::kPowConstant: {
+    auto base = children[0];
+    if (!base->is_scalar_) {
+      Accumulate(base, grad * node->operand_ *
+                           pow(base, node->operand_ - 1.0));
+    }
+    break;
+  }
+  case GradNode::Op::kDot: {
+    auto n = children.size() / 2;
+    for (size_t i = 0; i < n; i++) {
+      if (!children[i]->is_scalar_) {
+        Accumulate(children[i], grad * children[n + i]);
+      }
+      if (!children[n + i]->is_scalar_) {
+        Accumulate(children[n + i], grad * children[i]);
+      }
+    }
+    break;
+  }
+  case GradNode::Op::kDotConstant:
+    for (size_t i = 0; i < children.size(); i++) {
+      if (!children[i]->is_scalar_) {
+        Accumulate(children[i], grad * node->operands_[i]);
+      }
+    }
+    break;
+  }
+}
+
+std::vector<double>
+HessianVectorProduct(const std::shared_ptr<GradNode> &output,
+                     const std::vector<std::shared_ptr<GradNode>> &inputs,
+                     const std::vector<double> &v) {
+  if (v.size() != inputs.size()) {
+    throw std::invalid_argument(
+        "HessianVectorProduct vector and inputs differ in length");
+  }
+  EnableGradGuard enable_grad;
+  GradientGraph gradient(output, inputs);
+  auto product = Dot(gradient.Gradients(), v);
+
+  // The product shares nodes with the original graph. Start their gradients
+  // from zero, and restore them once the product is differentiated.
+  std::vector<GradNode *> order;
+  internal::TopologicalSort(product.get(), &order);
+  std::vector<double> saved(order.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    saved[i] = order[i]->GetGrad();
+    order[i]->ZeroGrad();
+  }
+  product->Backward();
+
+  std::unordered_set<GradNode *> reached(order.begin(), order.end());
+  std::vector<double> result;
+  result.reserve(inputs.size());
+  for (auto &input : inputs) {
+    result.push_back(reached.count(input.get()) > 0 ? input->GetGrad() : 0.0);
+  }
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i]->ZeroGrad();
+    order[i]->AccumulateGrad(saved[i]);
+  }
+  return result;
+}
+
+} // namespace micrograd
+} // namespace apexkid
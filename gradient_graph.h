@@ -0,0 +1,99 @@
+#ifndef GRADIENT_GRAPH_H
+#define GRADIENT_GRAPH_H
+
+#include "micrograd.h"
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+/**
+ * @class GradientGraph
+ * @brief The gradients of a GradNode output, recorded as GradNode graphs.
+ *
+ * GradNode::Backward() accumulates plain numbers, so its gradients cannot be
+ * differentiated again. GradientGraph instead walks the graph in reverse
+ * order and builds each gradient with the GradNode operators, following the
+ * Op of every node. The gradients are ordinary nodes: their values are the
+ * gradients Backward() computes, and calling Backward() on them, or building
+ * a GradientGraph of them, gives second and higher derivatives.
+ *
+ * The gradient graphs reference the nodes of the original graph, which must
+ * not be released while they are in use. They are recorded even under a
+ * NoGradGuard.
+ */
+class GradientGraph {
+public:
+  /**
+   * @brief Records the gradients of an output with respect to some nodes.
+   * @param output The node to differentiate.
+   * @param inputs The nodes to differentiate with respect to.
+   * @throws std::invalid_argument If the graph contains a custom node with
+   * children, whose backward function cannot be recorded.
+   */
+  GradientGraph(const std::shared_ptr<GradNode> &output,
+                const std::vector<std::shared_ptr<GradNode>> &inputs);
+
+  /**
+   * @brief Gets the gradients.
+   * @return The gradient of the output with respect to each input, in order.
+   */
+  const std::vector<std::shared_ptr<GradNode>> &Gradients() const {
+    return gradients_;
+  }
+
+  /**
+   * @brief Gets one gradient.
+   * @param i The index of the input.
+   * @return The gradient of the output with respect to input i.
+   */
+  const std::shared_ptr<GradNode> &Gradient(size_t i) const {
+    return gradients_[i];
+  }
+
+private:
+  /// A node reached by the reverse walk, and its gradient so far.
+  struct Adjoint {
+    std::shared_ptr<GradNode> node;
+    std::shared_ptr<GradNode> grad;
+  };
+
+  /// Adds a contribution to the gradient of a node.
+  void Accumulate(const std::shared_ptr<GradNode> &node,
+                  std::shared_ptr<GradNode> contribution);
+
+  /// Propagates the gradient of a node to its children.
+  void Propagate(const std::shared_ptr<GradNode> &node,
+                 std::shared_ptr<GradNode> grad);
+
+  // The gradients of the nodes reached so far, during construction.
+  std::unordered_map<GradNode *, Adjoint> adjoints_;
+  std::vector<std::shared_ptr<GradNode>> gradients_;
+};
+
+/**
+ * @brief Computes a Hessian-vector product without forming the Hessian.
+ *
+ * Records the gradient g of the output with a GradientGraph, then
+ * differentiates the dot product of g with v, which costs about one forward
+ * and two backward passes. The gradients of the graph are left unchanged.
+ * @param output The node to differentiate twice.
+ * @param inputs The nodes to differentiate with respect to.
+ * @param v The vector to multiply with, one entry per input.
+ * @return The product of the Hessian of the output and v.
+ * @throws std::invalid_argument If v and inputs differ in length, or the
+ * graph contains a custom node with children.
+ */
+std::vector<double>
+HessianVectorProduct(const std::shared_ptr<GradNode> &output,
+                     const std::vector<std::shared_ptr<GradNode>> &inputs,
+                     const std::vector<double> &v);
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // GRADIENT_GRAPH_H
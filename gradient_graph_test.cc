@@ -0,0 +1,115 @@
+#include "gradient_graph.h"
+#include "micrograd.h"
+#include "reference_expression.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+TEST(GradientGraphTest, MatchesBackward) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto b = GradNode::CreateGradnode(-0.25, "b");
+  auto e = GradNode::CreateGradnode(1.5, "e");
+  auto out = Sum({ReferenceExpression(w, b, e), Dot({w, b}, {3.0, 1.0}) * b,
+                  0.0 - w});
+  out->Backward();
+
+  GradientGraph gradient(out, {w, b, e});
+
+  EXPECT_NEAR(gradient.Gradient(0)->GetData(), w->GetGrad(), 1e-12);
+  EXPECT_NEAR(gradient.Gradient(1)->GetData(), b->GetGrad(), 1e-12);
+  EXPECT_NEAR(gradient.Gradient(2)->GetData(), e->GetGrad(), 1e-12);
+}
+
+// f(x) = x^4 has the derivatives 4x^3, 12x^2 and 24x.
+TEST(GradientGraphTest, HigherOrderDerivatives) {
+  auto x = GradNode::CreateGradnode(2.0, "x");
+  auto f = pow(x, 4);
+
+  GradientGraph first(f, {x});
+  GradientGraph second(first.Gradient(0), {x});
+  GradientGraph third(second.Gradient(0), {x});
+
+  EXPECT_DOUBLE_EQ(first.Gradient(0)->GetData(), 32.0);
+  EXPECT_DOUBLE_EQ(second.Gradient(0)->GetData(), 48.0);
+  EXPECT_DOUBLE_EQ(third.Gradient(0)->GetData(), 48.0);
+
+  // Backward on a gradient also gives the next derivative.
+  auto df = first.Gradient(0);
+  df->Backward();
+  EXPECT_DOUBLE_EQ(x->GetGrad(), 48.0);
+}
+
+TEST(GradientGraphTest, UnreachedInputHasZeroGradient) {
+  auto x = GradNode::CreateGradnode(2.0, "x");
+  auto y = GradNode::CreateGradnode(3.0, "y");
+  auto f = x * 5.0;
+
+  GradientGraph gradient(f, {x, y});
+
+  EXPECT_EQ(gradient.Gradient(0)->GetData(), 5.0);
+  EXPECT_EQ(gradient.Gradient(1)->GetData(), 0.0);
+}
+
+// The Hessian of f(x, y) = x^2 y + x / y is
+// [[2y, 2x - 1/y^2], [2x - 1/y^2, 2x/y^3]].
+TEST(GradientGraphTest, HessianVectorProduct) {
+  auto x = GradNode::CreateGradnode(3.0, "x");
+  auto y = GradNode::CreateGradnode(2.0, "y");
+  auto x_squared = pow(x, 2);
+  auto f = x_squared * y + x / y;
+  f->Backward();
+  auto x_grad = x->GetGrad();
+
+  auto hv = HessianVectorProduct(f, {x, y}, {1.0, -1.0});
+
+  double hxx = 2 * 2.0;
+  double hxy = 2 * 3.0 - 1 / 4.0;
+  double hyy = 2 * 3.0 / 8.0;
+  ASSERT_EQ(hv.size(), 2);
+  EXPECT_NEAR(hv[0], hxx - hxy, 1e-12);
+  EXPECT_NEAR(hv[1], hxy - hyy, 1e-12);
+  // The gradients of the original graph are left alone.
+  EXPECT_EQ(x->GetGrad(), x_grad);
+}
+
+// The gradient graphs are recorded even while graph construction is off.
+TEST(GradientGraphTest, HessianVectorProductUnderNoGradGuard) {
+  auto x = GradNode::CreateGradnode(3.0, "x");
+  auto f = pow(x, 3);
+
+  NoGradGuard no_grad;
+  GradientGraph gradient(f, {x});
+  auto hv = HessianVectorProduct(f, {x}, {1.0});
+
+  EXPECT_FALSE(GradNode::IsGradEnabled());
+  ASSERT_EQ(hv.size(), 1);
+  EXPECT_DOUBLE_EQ(hv[0], 6.0 * 3.0);
+  gradient.Gradient(0)->Backward();
+  EXPECT_DOUBLE_EQ(x->GetGrad(), 6.0 * 3.0);
+}
+
+TEST(GradientGraphTest, RejectsCustomNodes) {
+  auto x = GradNode::CreateGradnode(2.0, "x");
+  auto custom = GradNode::CreateGradnode(4.0, "", {x}, []() {});
+
+  EXPECT_THROW(GradientGraph(custom, {x}), std::invalid_argument);
+  EXPECT_THROW(HessianVectorProduct(custom, {x}, {1.0}),
+               std::invalid_argument);
+}
+
+TEST(GradientGraphTest, HessianVectorProductRejectsLengthMismatch) {
+  auto x = GradNode::CreateGradnode(2.0, "x");
+
+  EXPECT_THROW(HessianVectorProduct(x * 2.0, {x}, {}), std::invalid_argument);
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,63 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+namespace internal {
+
+/**
+ * @brief Reserves a fresh epoch for marking the nodes visited by a sort.
+ * @return An epoch no earlier sort has used.
+ */
+uint64_t NextSortEpoch();
+
+/**
+ * @brief Performs a topological sort of a computational graph.
+ *
+ * An iterative depth-first search that marks visited nodes with a per-sort
+ * epoch, so it neither recurses nor allocates a visited set. Node types
+ * provide a `children_` vector of shared pointers and a `visit_epoch_` stamp.
+ *
+ * The stamp lives in the nodes, so sorts of graphs that share nodes, such as
+ * per-thread losses over common parameters, must not run concurrently: each
+ * may overwrite the other's marks and skip nodes. Graphs without common
+ * nodes can be sorted on any number of threads.
+ * @param root The node whose graph is sorted.
+ * @param order Receives the nodes with every child before its parents, so
+ * the root comes last.
+ */
+template <typename Node>
+void TopologicalSort(Node *root, std::vector<Node *> *order) {
+  auto epoch = NextSortEpoch();
+  // Each frame holds a node and the index of the next child to visit.
+  thread_local std::vector<std::pair<Node *, size_t>> frames;
+  order->clear();
+  root->visit_epoch_ = epoch;
+  frames.emplace_back(root, 0);
+  while (!frames.empty()) {
+    auto *node = frames.back().first;
+    auto next = frames.back().second;
+    if (next < node->children_.size()) {
+      frames.back().second++;
+      auto *child = node->children_[next].get();
+      if (child->visit_epoch_ != epoch) {
+        child->visit_epoch_ = epoch;
+        frames.emplace_back(child, 0);
+      }
+      continue;
+    }
+    order->push_back(node);
+    frames.pop_back();
+  }
+}
+
+} // namespace internal
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // GRAPH_H
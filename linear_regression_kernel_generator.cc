@@ -0,0 +1,35 @@
+#include "codegen.h"
+#include "micrograd.h"
+#include <iostream>
+using namespace apexkid::micrograd;
+
+// Generates the forward and backward kernels of the linear regression demo's
+// per-sample loss, (w1*x1 + w2*x2 + w3*x3 + b - y)^2. The inputs are
+// {x1, x2, x3, y} and the parameters {w1, w2, w3, b}.
+//
+// Usage: linear_regression_kernel_generator <header> <source>
+// Run by the micrograd_kernel rule in BUILD; see codegen.bzl.
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <header> <source>" << std::endl;
+    return 1;
+  }
+
+  auto w1 = GradNode::CreateGradnode(0.0, "w1");
+  auto w2 = GradNode::CreateGradnode(0.0, "w2");
+  auto w3 = GradNode::CreateGradnode(0.0, "w3");
+  auto b = GradNode::CreateGradnode(0.0, "b");
+  auto x1 = GradNode::CreateGradnode(0.0, "x1");
+  auto x2 = GradNode::CreateGradnode(0.0, "x2");
+  auto x3 = GradNode::CreateGradnode(0.0, "x3");
+  auto y = GradNode::CreateGradnode(0.0, "y");
+  auto pred = Dot({w1, w2, w3}, {x1, x2, x3}) + b;
+  auto diff = pred - y;
+  CodeGenerator generator(pow(diff, 2), {x1, x2, x3, y});
+
+  if (!generator.WriteFiles("LinearRegressionLoss", argv[1], argv[2])) {
+    std::cerr << "Could not write the kernel" << std::endl;
+    return 1;
+  }
+  return 0;
+}
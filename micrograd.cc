@@ -1,297 +1,1417 @@
 #include "micrograd.h"
+#include "graph.h"
+#include "numeric.h"
+#include "profiler.h"
+#include "thread_pool.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <memory>
-#include <set>
-#include <stack>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace apexkid {
 namespace micrograd {
 
-GradNode::GradNode(double data, std::string label,
-                   std::vector<std::shared_ptr<GradNode>> children,
-                   std::function<void()> backward_fn) {
+namespace {
+
+// Number of GradNode objects currently alive.
+std::atomic<size_t> live_node_count{0};
+
+// Source of the epochs used to mark visited nodes during a sort.
+std::atomic<uint64_t> sort_epoch{0};
+
+// Bumped whenever a graph is released, which invalidates cached sort orders.
+std::atomic<uint64_t> graph_generation{1};
+
+// Whether operations on this thread record a graph. See NoGradGuard.
+thread_local bool grad_enabled = true;
+
+// A buffer collecting the gradient contributions of a thread.
+template <typename Node, typename G> struct GradSink {
+  std::vector<std::pair<Node *, G>> *buffer = nullptr;
+  // Whether every contribution is buffered, or only those to the children
+  // shared within a level of a parallel backward pass.
+  bool buffer_all = true;
+};
+
+// Collects the gradient contributions of this thread while it runs part of a
+// parallel backward pass or a checkpointed segment. See
+// BasicGradNode::PropagateGrad.
+template <typename Node, typename G> thread_local GradSink<Node, G> grad_sink;
+
+// Sends the gradient contributions of this thread to buffers while in scope,
+// or straight to the nodes if there are none.
+template <typename Node, typename G> class GradSinkScope {
+public:
+  explicit GradSinkScope(std::vector<std::pair<Node *, G>> *buffer,
+                         bool buffer_all = true)
+      : previous_(grad_sink<Node, G>) {
+    grad_sink<Node, G> = {buffer, buffer_all};
+  }
+  ~GradSinkScope() { grad_sink<Node, G> = previous_; }
+
+  GradSinkScope(const GradSinkScope &) = delete;
+  GradSinkScope &operator=(const GradSinkScope &) = delete;
+
+private:
+  GradSink<Node, G> previous_;
+};
+
+// Reports the node built by an operator to the active profiler, if any.
+class ProfileOpScope {
+public:
+  explicit ProfileOpScope(GradNodeBase::Op op) : profiler_(Profiler::Active()) {
+    if (profiler_ != nullptr) {
+      profiler_->BeginOp(op);
+    }
+  }
+
+  ~ProfileOpScope() {
+    if (profiler_ != nullptr) {
+      profiler_->EndOp();
+    }
+  }
+
+private:
+  Profiler *profiler_;
+};
+
+// Reports a backward pass to the active profiler, if any, also when a
+// backward function throws.
+class ProfileBackwardScope {
+public:
+  ProfileBackwardScope() : profiler_(Profiler::Active()) {
+    if (profiler_ != nullptr) {
+      profiler_->BeginBackward();
+    }
+  }
+
+  ~ProfileBackwardScope() {
+    if (profiler_ != nullptr) {
+      profiler_->EndBackward();
+    }
+  }
+
+  ProfileBackwardScope(const ProfileBackwardScope &) = delete;
+  ProfileBackwardScope &operator=(const ProfileBackwardScope &) = delete;
+
+private:
+  Profiler *profiler_;
+};
+
+} // namespace
+
+template <typename T, typename G>
+BasicGradNode<T, G>::BasicGradNode(
+    T data, std::string label,
+    std::vector<std::shared_ptr<BasicGradNode>> children,
+    std::function<void()> backward_fn) {
   this->data_ = data;
-  this->label_ = label;
-  this->children_ = children;
-  this->backward_fn_ = backward_fn;
+  this->label_ = std::move(label);
+  this->children_ = std::move(children);
+  this->backward_fn_ = std::move(backward_fn);
+  this->op_ = Op::kCustom;
+  auto live_nodes = AddLiveNode();
+  if (auto *profiler = Profiler::Active()) {
+    profiler->RecordCustomNode(live_nodes, sizeof(BasicGradNode));
+  }
 }
 
-GradNode::GradNode(double data, std::string label) {
+template <typename T, typename G>
+BasicGradNode<T, G>::BasicGradNode(T data, std::string label) {
   this->data_ = data;
-  this->label_ = label;
+  this->label_ = std::move(label);
+  auto live_nodes = AddLiveNode();
+  if (auto *profiler = Profiler::Active()) {
+    profiler->RecordNode(live_nodes, sizeof(BasicGradNode));
+  }
+}
+
+template <typename T, typename G>
+BasicGradNode<T, G>::~BasicGradNode() {
+  // Take over the children of nodes that die with this one, so that freeing a
+  // deep chain runs in a loop instead of recursing once per node.
+  auto pending = std::move(children_);
+  while (!pending.empty()) {
+    auto node = std::move(pending.back());
+    pending.pop_back();
+    if (node.use_count() == 1) {
+      for (auto &child : node->children_) {
+        pending.push_back(std::move(child));
+      }
+      node->children_.clear();
+    }
+  }
+  RemoveLiveNode();
+}
+
+bool GradNodeBase::IsGradEnabled() { return grad_enabled; }
+
+NoGradGuard::NoGradGuard() : previous_(grad_enabled) { grad_enabled = false; }
+
+NoGradGuard::~NoGradGuard() { grad_enabled = previous_; }
+
+EnableGradGuard::EnableGradGuard() : previous_(grad_enabled) {
+  grad_enabled = true;
 }
 
-void GradNode::MakeScalar() { is_scalar_ = true; }
+EnableGradGuard::~EnableGradGuard() { grad_enabled = previous_; }
+
+namespace internal {
 
-std::shared_ptr<GradNode> GradNode::CreateGradnode(double data,
-                                                   std::string label) {
-  return std::make_shared<GradNode>(data, label);
+uint64_t NextSortEpoch() {
+  return sort_epoch.fetch_add(1, std::memory_order_relaxed) + 1;
 }
 
-double GradNode::GetGrad() { return grad_; }
-double GradNode::GetData() { return data_; }
+} // namespace internal
 
-std::shared_ptr<GradNode>
-GradNode::CreateGradnode(double data, std::string label,
-                         std::vector<std::shared_ptr<GradNode>> children,
-                         std::function<void()> backward_fn) {
-  return std::make_shared<GradNode>(data, label, children, backward_fn);
-}
-
-void GradNode::Backward() {
-  grad_ = 1.0;
-  auto node_stack = TopologicalSort();
-  while (!node_stack.empty()) {
-    auto *node = node_stack.top();
-    if (node->backward_fn_ == nullptr) {
-      node_stack.pop();
-      continue;
+size_t GradNodeBase::LiveNodeCount() {
+  return live_node_count.load(std::memory_order_relaxed);
+}
+
+size_t GradNodeBase::AddLiveNode() {
+  return live_node_count.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void GradNodeBase::RemoveLiveNode() {
+  live_node_count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+uint64_t GradNodeBase::GraphGeneration() {
+  return graph_generation.load(std::memory_order_relaxed);
+}
+
+void GradNodeBase::NextGraphGeneration() {
+  graph_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename T, typename G>
+void BasicGradNode<T, G>::ReleaseGraph() {
+  NextGraphGeneration();
+  topological_order_.clear();
+  auto children = std::move(children_);
+  children_.clear();
+  backward_fn_ = nullptr;
+
+  // A node below this one is released once every reference to it comes from
+  // released nodes. Nodes still used by other graphs or handles keep their
+  // subgraph.
+  std::unordered_map<BasicGradNode *, long> references;
+  std::vector<BasicGradNode *> released;
+  auto count_references = [&](const auto &nodes) {
+    for (auto &child : nodes) {
+      if (++references[child.get()] == child.use_count()) {
+        released.push_back(child.get());
+      }
     }
-    node->backward_fn_();
-    node_stack.pop();
+  };
+  count_references(children);
+  for (size_t i = 0; i < released.size(); i++) {
+    count_references(released[i]->children_);
+  }
+  // Parents come before their children, so detach in reverse: a node is
+  // freed only after its own children were dropped, and while its parents
+  // still hold it.
+  for (auto it = released.rbegin(); it != released.rend(); ++it) {
+    auto *node = *it;
+    node->children_.clear();
+    node->backward_fn_ = nullptr;
+    node->topological_order_.clear();
   }
 }
 
-void GradNode::PrintNetwork() {
-  auto node_stack = TopologicalSort();
-  while (!node_stack.empty()) {
-    auto *node = node_stack.top();
-    std::cout << "Label:" << node->label_ << " Data:" << node->data_
-              << " Grad:" << node->grad_ << std::endl;
-    node_stack.pop();
+template <typename T, typename G>
+void BasicGradNode<T, G>::MakeScalar() { is_scalar_ = true; }
+
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+BasicGradNode<T, G>::CreateGradnode(T data, std::string label) {
+  return std::make_shared<BasicGradNode>(data, std::move(label));
+}
+
+template <typename T, typename G>
+std::string BasicGradNode<T, G>::GetLabel() const {
+  return RenderLabel(kMaxLabelDepth);
+}
+
+template <typename T, typename G>
+std::string BasicGradNode<T, G>::RenderLabel(int depth) const {
+  if (!label_.empty()) {
+    return label_;
+  }
+  if (children_.empty()) {
+    return std::to_string(data_);
+  }
+  if (depth == 0) {
+    return "...";
+  }
+  switch (op_) {
+  case Op::kAdd:
+    return children_[0]->RenderLabel(depth - 1) + "+" +
+           children_[1]->RenderLabel(depth - 1);
+  case Op::kSub:
+    return children_[0]->RenderLabel(depth - 1) + "-" +
+           children_[1]->RenderLabel(depth - 1);
+  case Op::kMul:
+    return children_[0]->RenderLabel(depth - 1) + "*" +
+           children_[1]->RenderLabel(depth - 1);
+  case Op::kDiv:
+    return children_[0]->RenderLabel(depth - 1) + "/" +
+           children_[1]->RenderLabel(depth - 1);
+  case Op::kPow:
+    return children_[0]->RenderLabel(depth - 1) + "^" +
+           children_[1]->RenderLabel(depth - 1);
+  case Op::kLog:
+    return "log(" + children_[0]->RenderLabel(depth - 1) + ")";
+  case Op::kSigmoid:
+    return "sigmoid(" + children_[0]->RenderLabel(depth - 1) + ")";
+  case Op::kTanh:
+    return "tanh(" + children_[0]->RenderLabel(depth - 1) + ")";
+  case Op::kRelu:
+    return "relu(" + children_[0]->RenderLabel(depth - 1) + ")";
+  case Op::kAddConstant:
+    return children_[0]->RenderLabel(depth - 1) + "+" +
+           std::to_string(operand_);
+  case Op::kSubConstant:
+    return children_[0]->RenderLabel(depth - 1) + "-" +
+           std::to_string(operand_);
+  case Op::kRSubConstant:
+    return std::to_string(operand_) + "-" +
+           children_[0]->RenderLabel(depth - 1);
+  case Op::kMulConstant:
+    return children_[0]->RenderLabel(depth - 1) + "*" +
+           std::to_string(operand_);
+  case Op::kDivConstant:
+    return children_[0]->RenderLabel(depth - 1) + "/" +
+           std::to_string(operand_);
+  case Op::kRDivConstant:
+    return std::to_string(operand_) + "/" +
+           children_[0]->RenderLabel(depth - 1);
+  case Op::kPowConstant:
+    return children_[0]->RenderLabel(depth - 1) + "^" +
+           std::to_string(operand_);
+  case Op::kSum: {
+    auto label = children_[0]->RenderLabel(depth - 1);
+    for (size_t i = 1; i < children_.size(); i++) {
+      label += "+" + children_[i]->RenderLabel(depth - 1);
+    }
+    return label;
+  }
+  case Op::kDot: {
+    auto n = children_.size() / 2;
+    std::string label;
+    for (size_t i = 0; i < n; i++) {
+      label += (i > 0 ? "+" : "") + children_[i]->RenderLabel(depth - 1) +
+               "*" + children_[n + i]->RenderLabel(depth - 1);
+    }
+    return label;
+  }
+  case Op::kDotConstant: {
+    std::string label;
+    for (size_t i = 0; i < children_.size(); i++) {
+      label += (i > 0 ? "+" : "") + children_[i]->RenderLabel(depth - 1) +
+               "*" + std::to_string(operands_[i]);
+    }
+    return label;
   }
+  case Op::kLeaf:
+  case Op::kCustom:
+    break;
+  }
+  return std::to_string(data_);
 }
 
-std::stack<const GradNode *> GradNode::TopologicalSort() {
-  std::stack<const GradNode *> stack;
-  std::set<const GradNode *> visited;
+template <typename T, typename G>
+void BasicGradNode<T, G>::Recompute() {
+  switch (op_) {
+  case Op::kAdd:
+    data_ = children_[0]->data_ + children_[1]->data_;
+    break;
+  case Op::kSub:
+    data_ = children_[0]->data_ - children_[1]->data_;
+    break;
+  case Op::kMul:
+    data_ = children_[0]->data_ * children_[1]->data_;
+    break;
+  case Op::kDiv:
+    data_ = children_[0]->data_ / children_[1]->data_;
+    break;
+  case Op::kPow:
+    data_ = std::pow(children_[0]->data_, children_[1]->data_);
+    break;
+  case Op::kLog:
+    data_ = std::log(children_[0]->data_);
+    break;
+  case Op::kSigmoid:
+    data_ = internal::StableSigmoid(children_[0]->data_);
+    break;
+  case Op::kTanh:
+    data_ = std::tanh(children_[0]->data_);
+    break;
+  case Op::kRelu:
+    data_ = std::max(children_[0]->data_, T(0));
+    break;
+  case Op::kAddConstant:
+    data_ = children_[0]->data_ + operand_;
+    break;
+  case Op::kSubConstant:
+    data_ = children_[0]->data_ - operand_;
+    break;
+  case Op::kRSubConstant:
+    data_ = operand_ - children_[0]->data_;
+    break;
+  case Op::kMulConstant:
+    data_ = children_[0]->data_ * operand_;
+    break;
+  case Op::kDivConstant:
+    data_ = children_[0]->data_ / operand_;
+    break;
+  case Op::kRDivConstant:
+    data_ = operand_ / children_[0]->data_;
+    break;
+  case Op::kPowConstant:
+    data_ = std::pow(children_[0]->data_, operand_);
+    break;
+  case Op::kSum:
+    data_ = children_[0]->data_;
+    for (size_t i = 1; i < children_.size(); i++) {
+      data_ += children_[i]->data_;
+    }
+    break;
+  case Op::kDot: {
+    auto n = children_.size() / 2;
+    data_ = children_[0]->data_ * children_[n]->data_;
+    for (size_t i = 1; i < n; i++) {
+      data_ += children_[i]->data_ * children_[n + i]->data_;
+    }
+    break;
+  }
+  case Op::kDotConstant:
+    data_ = children_[0]->data_ * operands_[0];
+    for (size_t i = 1; i < children_.size(); i++) {
+      data_ += children_[i]->data_ * operands_[i];
+    }
+    break;
+  case Op::kLeaf:
+  case Op::kCustom:
+    break;
+  }
+}
 
-  TopologicalSortUtil(*this, stack, visited);
-  return stack;
+template <typename T, typename G>
+G BasicGradNode<T, G>::GetGrad() { return grad_; }
+template <typename T, typename G>
+T BasicGradNode<T, G>::GetData() { return data_; }
+template <typename T, typename G>
+void BasicGradNode<T, G>::SetData(T data) { data_ = data; }
+template <typename T, typename G>
+void BasicGradNode<T, G>::ZeroGrad() { grad_ = G(0); }
+template <typename T, typename G>
+void BasicGradNode<T, G>::AccumulateGrad(G grad) { PropagateGrad(this, grad); }
+
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>> BasicGradNode<T, G>::CreateGradnode(
+    T data, std::string label,
+    std::vector<std::shared_ptr<BasicGradNode>> children,
+    std::function<void()> backward_fn) {
+  return std::make_shared<BasicGradNode>(data, std::move(label),
+                                         std::move(children),
+                                         std::move(backward_fn));
 }
 
-void GradNode::TopologicalSortUtil(const GradNode &node,
-                                   std::stack<const GradNode *> &stack,
-                                   std::set<const GradNode *> &visited) {
-  if (visited.find(&node) != visited.end()) {
+template <typename T, typename G>
+void BasicGradNode<T, G>::Backward() {
+  grad_ = G(1);
+  const auto &order = TopologicalSort();
+  ProfileBackwardScope profile;
+  // A backward pass nested in a parallel one, as a custom backward function
+  // may run, applies its contributions directly rather than to the outer
+  // pass's buffer.
+  GradSinkScope<BasicGradNode, G> no_sink(nullptr);
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    auto *node = *it;
+    if (node->backward_fn_ != nullptr) {
+      node->backward_fn_();
+    }
+  }
+}
+
+template <typename T, typename G>
+void BasicGradNode<T, G>::Backward(ThreadPool &pool) {
+  if (pool.NumThreads() == 1) {
+    Backward();
     return;
   }
+  grad_ = G(1);
+  auto &levels = GetBackwardLevels();
+  ProfileBackwardScope profile;
 
-  for (auto &child : node.children_) {
-    TopologicalSortUtil(*child, stack, visited);
+  // Mark the children that several nodes of one level contribute to, so that
+  // only their contributions are buffered.
+  for (auto *node : levels.shared) {
+    node->shared_child_ = true;
   }
+  auto &sinks = levels.sinks;
+  const auto &nodes = levels.nodes;
+  auto num_levels = levels.level_begin.size() - 1;
+  for (size_t level = 0; level < num_levels; level++) {
+    auto begin = levels.level_begin[level];
+    auto end = levels.level_begin[level + 1];
+    if (end - begin < kMinParallelLevelSize) {
+      for (auto i = begin; i < end; i++) {
+        if (nodes[i]->backward_fn_ != nullptr) {
+          nodes[i]->backward_fn_();
+        }
+      }
+      continue;
+    }
 
-  stack.push(&node);
-  visited.emplace(&node);
+    auto num_chunks =
+        (end - begin + kParallelChunkSize - 1) / kParallelChunkSize;
+    if (sinks.size() < num_chunks) {
+      sinks.resize(num_chunks);
+    }
+    pool.ParallelFor(num_chunks, [&](size_t chunk) {
+      auto &sink = sinks[chunk];
+      sink.clear();
+      GradSinkScope<BasicGradNode, G> scope(&sink, false);
+      auto chunk_begin = begin + chunk * kParallelChunkSize;
+      auto chunk_end = std::min(end, chunk_begin + kParallelChunkSize);
+      for (auto i = chunk_begin; i < chunk_end; i++) {
+        if (nodes[i]->backward_fn_ != nullptr) {
+          // A custom backward function may add to any node, so all of its
+          // contributions are buffered.
+          grad_sink<BasicGradNode, G>.buffer_all =
+              nodes[i]->op_ == Op::kCustom;
+          nodes[i]->backward_fn_();
+        }
+      }
+    });
+    // Add the buffered contributions in chunk order, so that the result does
+    // not depend on scheduling.
+    for (size_t chunk = 0; chunk < num_chunks; chunk++) {
+      for (auto &contribution : sinks[chunk]) {
+        contribution.first->grad_ += contribution.second;
+      }
+    }
+  }
+  for (auto *node : levels.shared) {
+    node->shared_child_ = false;
+  }
 }
 
-std::shared_ptr<GradNode> operator+(double a,
-                                    const std::shared_ptr<GradNode> &b) {
-  auto gradnode = GradNode::CreateGradnode(a, std::to_string(a));
-  gradnode->MakeScalar();
-  return gradnode + b;
+template <typename T, typename G>
+typename BasicGradNode<T, G>::BackwardLevels &
+BasicGradNode<T, G>::GetBackwardLevels() {
+  auto generation = GraphGeneration();
+  const auto &order = TopologicalSort();
+  if (backward_levels_ == nullptr) {
+    backward_levels_ = std::make_unique<BackwardLevels>();
+  } else if (backward_levels_->generation == generation) {
+    return *backward_levels_;
+  }
+
+  // Assign each node the length of its longest path from this node. The
+  // order lists parents after their children, so walking it backwards
+  // settles a node's level before its children are visited.
+  for (auto *node : order) {
+    node->backward_level_ = 0;
+  }
+  size_t num_levels = 1;
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    auto *node = *it;
+    for (auto &child : node->children_) {
+      child->backward_level_ =
+          std::max(child->backward_level_, node->backward_level_ + 1);
+      num_levels = std::max(num_levels, child->backward_level_ + 1);
+    }
+  }
+
+  // Bucket the nodes by level.
+  auto &level_begin = backward_levels_->level_begin;
+  level_begin.assign(num_levels + 1, 0);
+  for (auto *node : order) {
+    level_begin[node->backward_level_ + 1]++;
+  }
+  for (size_t level = 0; level < num_levels; level++) {
+    level_begin[level + 1] += level_begin[level];
+  }
+  auto &nodes = backward_levels_->nodes;
+  nodes.resize(order.size());
+  auto next = level_begin;
+  for (auto *node : order) {
+    nodes[next[node->backward_level_]++] = node;
+  }
+
+  // Find the children of more than one node of a level. backward_level_ now
+  // holds one more than the index of the last parent visited, so a child was
+  // reached before from the same level if that parent is at least begin.
+  for (auto *node : order) {
+    node->backward_level_ = 0;
+  }
+  auto &shared = backward_levels_->shared;
+  shared.clear();
+  for (size_t level = 0; level < num_levels; level++) {
+    auto begin = level_begin[level];
+    for (auto i = begin; i < level_begin[level + 1]; i++) {
+      for (auto &child : nodes[i]->children_) {
+        auto last_parent = child->backward_level_;
+        if (last_parent > begin && last_parent != i + 1 &&
+            !child->shared_child_) {
+          child->shared_child_ = true;
+          shared.push_back(child.get());
+        }
+        child->backward_level_ = i + 1;
+      }
+    }
+  }
+  for (auto *node : shared) {
+    node->shared_child_ = false;
+  }
+  backward_levels_->generation = generation;
+  return *backward_levels_;
 }
 
-std::shared_ptr<GradNode> operator+(const std::shared_ptr<GradNode> &a,
-                                    double b) {
-  auto gradnode = GradNode::CreateGradnode(b, std::to_string(b));
-  gradnode->MakeScalar();
-  return a + gradnode;
+template <typename T, typename G>
+void BasicGradNode<T, G>::PropagateGrad(BasicGradNode *node, G grad) {
+  auto &sink = grad_sink<BasicGradNode, G>;
+  if (sink.buffer == nullptr || (!sink.buffer_all && !node->shared_child_)) {
+    node->grad_ += grad;
+  } else if (!sink.buffer->empty() && sink.buffer->back().first == node) {
+    // Merge consecutive contributions, such as those of a chunk of nodes to
+    // a shared parameter.
+    sink.buffer->back().second += grad;
+  } else {
+    sink.buffer->emplace_back(node, grad);
+  }
 }
 
-std::shared_ptr<GradNode> operator+(const std::shared_ptr<GradNode> &a,
-                                    const std::shared_ptr<GradNode> &b) {
+template <typename T, typename G>
+void BasicGradNode<T, G>::PrintNetwork() {
+  const auto &order = TopologicalSort();
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    auto *node = *it;
+    std::cout << "Label:" << node->GetLabel() << " Data:" << node->data_
+              << " Grad:" << node->grad_ << std::endl;
+  }
+}
+
+template <typename T, typename G>
+const std::vector<BasicGradNode<T, G> *> &
+BasicGradNode<T, G>::TopologicalSort() {
+  auto generation = GraphGeneration();
+  if (!topological_order_.empty() &&
+      topological_order_generation_ == generation) {
+    return topological_order_;
+  }
+
+  auto *profiler = Profiler::Active();
+  if (profiler != nullptr) {
+    profiler->BeginSort();
+  }
+  internal::TopologicalSort(this, &topological_order_);
+  if (profiler != nullptr) {
+    profiler->EndSort();
+  }
+  topological_order_generation_ = generation;
+  return topological_order_;
+}
+
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator+(internal::NonDeduced<T> a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kAddConstant);
+  auto output_data = a + b->data_;
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{b};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kAddConstant;
+  result->operand_ = a;
+  result->children_ = output_children;
+  result->backward_fn_ = [b = b.get(), result = result.get()]() {
+    if (!b->is_scalar_) {
+      Node::PropagateGrad(b, result->grad_);
+    }
+  };
+  return result;
+}
+
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator+(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          internal::NonDeduced<T> b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kAddConstant);
+  auto output_data = a->data_ + b;
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{a};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kAddConstant;
+  result->operand_ = b;
+  result->children_ = output_children;
+  result->backward_fn_ = [a = a.get(), result = result.get()]() {
+    if (!a->is_scalar_) {
+      Node::PropagateGrad(a, result->grad_);
+    }
+  };
+  return result;
+}
+
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator+(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kAdd);
 
   auto output_data = a->data_ + b->data_;
-  auto output_label = a->label_ + "+" + b->label_;
-  auto output_children = std::vector<std::shared_ptr<GradNode>>{a, b};
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{a, b};
 
-  auto result = GradNode::CreateGradnode(output_data, output_label);
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kAdd;
   result->children_ = output_children;
-  result->backward_fn_ = [a, b, result]() {
+  result->backward_fn_ = [a = a.get(), b = b.get(),
+                          result = result.get()]() {
     if (!a->is_scalar_) {
-      a->grad_ += result->grad_;
+      Node::PropagateGrad(a, result->grad_);
     }
     if (!b->is_scalar_) {
-      b->grad_ += result->grad_;
+      Node::PropagateGrad(b, result->grad_);
     }
   };
 
   return result;
 }
 
-std::shared_ptr<GradNode> operator-(double a,
-                                    const std::shared_ptr<GradNode> &b) {
-  auto gradnode = GradNode::CreateGradnode(a, std::to_string(a));
-  gradnode->MakeScalar();
-  return gradnode - b;
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator-(internal::NonDeduced<T> a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kRSubConstant);
+  auto output_data = a - b->data_;
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{b};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kRSubConstant;
+  result->operand_ = a;
+  result->children_ = output_children;
+  result->backward_fn_ = [b = b.get(), result = result.get()]() {
+    if (!b->is_scalar_) {
+      Node::PropagateGrad(b, -result->grad_);
+    }
+  };
+  return result;
 }
 
-std::shared_ptr<GradNode> operator-(const std::shared_ptr<GradNode> &a,
-                                    double b) {
-  auto gradnode = GradNode::CreateGradnode(b, std::to_string(b));
-  gradnode->MakeScalar();
-  return a - gradnode;
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator-(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          internal::NonDeduced<T> b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kSubConstant);
+  auto output_data = a->data_ - b;
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{a};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kSubConstant;
+  result->operand_ = b;
+  result->children_ = output_children;
+  result->backward_fn_ = [a = a.get(), result = result.get()]() {
+    if (!a->is_scalar_) {
+      Node::PropagateGrad(a, result->grad_);
+    }
+  };
+  return result;
 }
 
-std::shared_ptr<GradNode> operator-(const std::shared_ptr<GradNode> &a,
-                                    const std::shared_ptr<GradNode> &b) {
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator-(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kSub);
   auto output_data = a->data_ - b->data_;
-  auto output_label = a->label_ + "-" + b->label_;
-  auto output_children = std::vector<std::shared_ptr<GradNode>>{a, b};
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{a, b};
 
-  auto result = GradNode::CreateGradnode(output_data, output_label);
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kSub;
   result->children_ = output_children;
-  result->backward_fn_ = [a, b, result]() {
+  result->backward_fn_ = [a = a.get(), b = b.get(),
+                          result = result.get()]() {
     if (!a->is_scalar_) {
-      a->grad_ += result->grad_;
+      Node::PropagateGrad(a, result->grad_);
     }
     if (!b->is_scalar_) {
-      b->grad_ -= result->grad_;
+      Node::PropagateGrad(b, -result->grad_);
     }
   };
 
   return result;
 }
 
-std::shared_ptr<GradNode> operator*(double a,
-                                    const std::shared_ptr<GradNode> &b) {
-  auto gradnode = GradNode::CreateGradnode(a, std::to_string(a));
-  gradnode->MakeScalar();
-  return gradnode * b;
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator*(internal::NonDeduced<T> a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kMulConstant);
+  auto output_data = a * b->data_;
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{b};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kMulConstant;
+  result->operand_ = a;
+  result->children_ = output_children;
+  result->backward_fn_ = [b = b.get(), result = result.get()]() {
+    if (!b->is_scalar_) {
+      Node::PropagateGrad(b, result->grad_ * result->operand_);
+    }
+  };
+  return result;
 }
 
-std::shared_ptr<GradNode> operator*(const std::shared_ptr<GradNode> &a,
-                                    double b) {
-  auto gradnode = GradNode::CreateGradnode(b, std::to_string(b));
-  gradnode->MakeScalar();
-  return a * gradnode;
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator*(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          internal::NonDeduced<T> b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kMulConstant);
+  auto output_data = a->data_ * b;
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{a};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kMulConstant;
+  result->operand_ = b;
+  result->children_ = output_children;
+  result->backward_fn_ = [a = a.get(), result = result.get()]() {
+    if (!a->is_scalar_) {
+      Node::PropagateGrad(a, result->grad_ * result->operand_);
+    }
+  };
+  return result;
 }
 
-std::shared_ptr<GradNode> operator*(const std::shared_ptr<GradNode> &a,
-                                    const std::shared_ptr<GradNode> &b) {
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator*(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kMul);
 
   auto output_data = a->data_ * b->data_;
-  auto output_label = a->label_ + "*" + b->label_;
-  auto output_children = std::vector<std::shared_ptr<GradNode>>{a, b};
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{a, b};
 
-  auto result = GradNode::CreateGradnode(output_data, output_label);
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kMul;
   result->children_ = output_children;
-  result->backward_fn_ = [a, b, result]() {
+  result->backward_fn_ = [a = a.get(), b = b.get(),
+                          result = result.get()]() {
     if (!a->is_scalar_) {
-      a->grad_ += (result->grad_ * b->data_);
+      Node::PropagateGrad(a, result->grad_ * b->data_);
     }
     if (!b->is_scalar_) {
-      b->grad_ += (result->grad_ * a->data_);
+      Node::PropagateGrad(b, result->grad_ * a->data_);
     }
   };
   return result;
 }
 
-std::shared_ptr<GradNode> operator/(double a,
-                                    const std::shared_ptr<GradNode> &b) {
-  auto gradnode = GradNode::CreateGradnode(a, std::to_string(a));
-  gradnode->MakeScalar();
-  return gradnode / b;
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator/(internal::NonDeduced<T> a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kRDivConstant);
+  auto output_data = a / b->data_;
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{b};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kRDivConstant;
+  result->operand_ = a;
+  result->children_ = output_children;
+  result->backward_fn_ = [b = b.get(), result = result.get()]() {
+    if (!b->is_scalar_) {
+      Node::PropagateGrad(
+          b, -(result->grad_ * result->operand_ / std::pow(b->data_, 2)));
+    }
+  };
+  return result;
 }
 
-std::shared_ptr<GradNode> operator/(const std::shared_ptr<GradNode> &a,
-                                    double b) {
-  auto gradnode = GradNode::CreateGradnode(b, std::to_string(b));
-  gradnode->MakeScalar();
-  return a / gradnode;
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator/(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          internal::NonDeduced<T> b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kDivConstant);
+  auto output_data = a->data_ / b;
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{a};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kDivConstant;
+  result->operand_ = b;
+  result->children_ = output_children;
+  result->backward_fn_ = [a = a.get(), result = result.get()]() {
+    if (!a->is_scalar_) {
+      Node::PropagateGrad(a, result->grad_ / result->operand_);
+    }
+  };
+  return result;
 }
 
-std::shared_ptr<GradNode> operator/(const std::shared_ptr<GradNode> &a,
-                                    const std::shared_ptr<GradNode> &b) {
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator/(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kDiv);
   auto output_data = a->data_ / b->data_;
-  auto output_label = a->label_ + "/" + b->label_;
-  auto output_children = std::vector<std::shared_ptr<GradNode>>{a, b};
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{a, b};
 
-  auto result = GradNode::CreateGradnode(output_data, output_label);
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kDiv;
   result->children_ = output_children;
-  result->backward_fn_ = [a, b, result]() {
+  result->backward_fn_ = [a = a.get(), b = b.get(),
+                          result = result.get()]() {
     if (!a->is_scalar_) {
-      a->grad_ += (result->grad_ / b->data_);
+      Node::PropagateGrad(a, result->grad_ / b->data_);
     }
     if (!b->is_scalar_) {
-      b->grad_ -= (result->grad_ * a->data_ / std::pow(b->data_, 2));
+      Node::PropagateGrad(
+          b, -(result->grad_ * a->data_ / std::pow(b->data_, 2)));
     }
   };
   return result;
 }
 
-std::shared_ptr<GradNode> pow(std::shared_ptr<GradNode> &base,
-                              double exponent) {
-  auto gradnode = GradNode::CreateGradnode(exponent, std::to_string(exponent));
-  gradnode->MakeScalar();
-  return pow(base, gradnode);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+pow(std::shared_ptr<BasicGradNode<T, G>> &base,
+    internal::NonDeduced<T> exponent) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kPowConstant);
+  auto output_data = std::pow(base->data_, exponent);
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{base};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kPowConstant;
+  result->operand_ = exponent;
+  result->children_ = output_children;
+  result->backward_fn_ = [base = base.get(), result = result.get()]() {
+    if (!base->is_scalar_) {
+      Node::PropagateGrad(
+          base, result->grad_ * result->operand_ *
+                    std::pow(base->data_, result->operand_ - 1));
+    }
+  };
+  return result;
 }
 
-std::shared_ptr<GradNode> pow(std::shared_ptr<GradNode> &base,
-                              std::shared_ptr<GradNode> &exponent) {
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+pow(std::shared_ptr<BasicGradNode<T, G>> &base,
+    std::shared_ptr<BasicGradNode<T, G>> &exponent) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kPow);
   auto output_data = std::pow(base->data_, exponent->data_);
-  auto output_label = base->label_ + "^" + exponent->label_;
-  auto output_children = std::vector<std::shared_ptr<GradNode>>{base, exponent};
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{base, exponent};
 
-  auto result = GradNode::CreateGradnode(output_data, output_label);
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kPow;
   result->children_ = output_children;
-  result->backward_fn_ = [base, exponent, result]() {
+  result->backward_fn_ = [base = base.get(), exponent = exponent.get(),
+                          result = result.get()]() {
     if (!base->is_scalar_) {
-      base->grad_ += result->grad_ * exponent->data_ *
-                     std::pow(base->data_, exponent->data_ - 1);
+      Node::PropagateGrad(base,
+                          result->grad_ * exponent->data_ *
+                              std::pow(base->data_, exponent->data_ - 1));
     }
     if (!exponent->is_scalar_) {
-      exponent->grad_ += result->grad_ *
-                         std::pow(base->data_, exponent->data_) *
-                         std::log(base->data_);
+      Node::PropagateGrad(exponent,
+                          result->grad_ *
+                              std::pow(base->data_, exponent->data_) *
+                              std::log(base->data_));
     }
   };
   return result;
 }
 
-std::shared_ptr<GradNode> log(std::shared_ptr<GradNode> &x) {
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+log(std::shared_ptr<BasicGradNode<T, G>> &x) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kLog);
   auto output_data = std::log(x->data_);
-  auto output_label = "log(" + x->label_ + ")";
-  auto output_children = std::vector<std::shared_ptr<GradNode>>{x};
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{x};
 
-  auto result = GradNode::CreateGradnode(output_data, output_label);
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kLog;
   result->children_ = output_children;
-  result->backward_fn_ = [x, result]() {
+  result->backward_fn_ = [x = x.get(), result = result.get()]() {
     if (!x->is_scalar_) {
-      x->grad_ += (result->grad_ * (1 / x->data_));
+      Node::PropagateGrad(x, result->grad_ * (1 / x->data_));
     }
   };
   return result;
 }
 
-std::shared_ptr<GradNode> sigmoid(std::shared_ptr<GradNode> &x) {
-  auto e = GradNode::CreateGradnode(std::exp(1), "E");
-  e->MakeScalar();
-  auto minus_x = -1 * x;
-  auto result = 1.0 / (1.0 + pow(e, minus_x));
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+sigmoid(std::shared_ptr<BasicGradNode<T, G>> &x) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kSigmoid);
+  auto output_data = internal::StableSigmoid(x->data_);
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{x};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kSigmoid;
+  result->children_ = output_children;
+  result->backward_fn_ = [x = x.get(), result = result.get()]() {
+    if (!x->is_scalar_) {
+      Node::PropagateGrad(
+          x, result->grad_ * result->data_ * (1.0 - result->data_));
+    }
+  };
   return result;
 }
 
-std::shared_ptr<GradNode> tanh(std::shared_ptr<GradNode> &x) {
-  auto e = GradNode::CreateGradnode(std::exp(1), "E");
-  e->MakeScalar();
-  auto minus_x = -1 * x;
-  auto result = (pow(e, x) - pow(e, minus_x)) / (pow(e, x) + pow(e, minus_x));
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+tanh(std::shared_ptr<BasicGradNode<T, G>> &x) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kTanh);
+  auto output_data = std::tanh(x->data_);
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{x};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kTanh;
+  result->children_ = output_children;
+  result->backward_fn_ = [x = x.get(), result = result.get()]() {
+    if (!x->is_scalar_) {
+      Node::PropagateGrad(
+          x, result->grad_ * (1.0 - result->data_ * result->data_));
+    }
+  };
   return result;
 }
 
-std::shared_ptr<GradNode> relu(std::shared_ptr<GradNode> &x) {
-  auto zero = GradNode::CreateGradnode(0.0, "0");
-  zero->MakeScalar();
-  auto result = x->GetData() > 0 ? x : zero;
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+relu(std::shared_ptr<BasicGradNode<T, G>> &x) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kRelu);
+  auto output_data = std::max(x->data_, T(0));
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  auto output_children = std::vector<std::shared_ptr<Node>>{x};
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kRelu;
+  result->children_ = output_children;
+  result->backward_fn_ = [x = x.get(), result = result.get()]() {
+    if (!x->is_scalar_ && x->data_ > 0) {
+      Node::PropagateGrad(x, result->grad_);
+    }
+  };
   return result;
 }
 
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+Sum(const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &xs) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kSum);
+  if (xs.empty()) {
+    return Node::CreateGradnode(T(0), "");
+  }
+  auto output_data = xs[0]->data_;
+  for (size_t i = 1; i < xs.size(); i++) {
+    output_data += xs[i]->data_;
+  }
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kSum;
+  result->children_ = xs;
+  result->backward_fn_ = [result = result.get()]() {
+    for (auto &x : result->children_) {
+      if (!x->is_scalar_) {
+        Node::PropagateGrad(x.get(), result->grad_);
+      }
+    }
+  };
+  return result;
+}
+
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+Dot(const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &a,
+    const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kDot);
+  if (a.size() != b.size()) {
+    throw std::invalid_argument("Dot operands differ in length");
+  }
+  if (a.empty()) {
+    return Node::CreateGradnode(T(0), "");
+  }
+  auto output_data = a[0]->data_ * b[0]->data_;
+  for (size_t i = 1; i < a.size(); i++) {
+    output_data += a[i]->data_ * b[i]->data_;
+  }
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+  // The children are a followed by b.
+  auto output_children = a;
+  output_children.insert(output_children.end(), b.begin(), b.end());
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kDot;
+  result->children_ = std::move(output_children);
+  result->backward_fn_ = [result = result.get()]() {
+    auto &children = result->children_;
+    auto n = children.size() / 2;
+    for (size_t i = 0; i < n; i++) {
+      auto *a = children[i].get();
+      auto *b = children[n + i].get();
+      if (!a->is_scalar_) {
+        Node::PropagateGrad(a, result->grad_ * b->data_);
+      }
+      if (!b->is_scalar_) {
+        Node::PropagateGrad(b, result->grad_ * a->data_);
+      }
+    }
+  };
+  return result;
+}
+
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+Dot(const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &a,
+    const std::vector<internal::NonDeduced<T>> &b) {
+  using Node = BasicGradNode<T, G>;
+  ProfileOpScope profile(Node::Op::kDotConstant);
+  if (a.size() != b.size()) {
+    throw std::invalid_argument("Dot operands differ in length");
+  }
+  if (a.empty()) {
+    return Node::CreateGradnode(T(0), "");
+  }
+  auto output_data = a[0]->data_ * b[0];
+  for (size_t i = 1; i < a.size(); i++) {
+    output_data += a[i]->data_ * b[i];
+  }
+  if (!Node::IsGradEnabled()) {
+    return Node::CreateGradnode(output_data, "");
+  }
+
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kDotConstant;
+  result->operands_ = b;
+  result->children_ = a;
+  result->backward_fn_ = [result = result.get()]() {
+    auto &children = result->children_;
+    for (size_t i = 0; i < children.size(); i++) {
+      if (!children[i]->is_scalar_) {
+        Node::PropagateGrad(children[i].get(),
+                            result->grad_ * result->operands_[i]);
+      }
+    }
+  };
+  return result;
+}
+
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+Checkpoint(const internal::NonDeduced<CheckpointFn<T, G>> &fn,
+           const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &inputs) {
+  using Node = BasicGradNode<T, G>;
+  if (!Node::IsGradEnabled()) {
+    return fn(inputs);
+  }
+
+  // The segment recorded on detached copies of the inputs, so that its
+  // backward pass stops at them.
+  struct Segment {
+    std::vector<std::shared_ptr<Node>> leaves; // The copies of the inputs.
+    std::shared_ptr<Node> output;
+    std::vector<Node *> order;    // The nodes fn created, parents first.
+    std::vector<Node *> captured; // The other nodes fn used.
+  };
+  auto record = [fn](const std::vector<std::shared_ptr<Node>> &inputs) {
+    Segment segment;
+    {
+      EnableGradGuard enable_grad;
+      segment.leaves.reserve(inputs.size());
+      for (auto &input : inputs) {
+        segment.leaves.push_back(Node::CreateGradnode(input->data_, ""));
+      }
+      segment.output = fn(segment.leaves);
+    }
+
+    // A node was created by fn once every reference to it comes from the
+    // nodes found before, so the input copies and any node fn captured are
+    // never found. Found nodes have their reference count set to -1.
+    std::unordered_map<Node *, long> references;
+    std::vector<Node *> reached;
+    std::vector<Node *> ready;
+    if (segment.output.use_count() == 1) {
+      ready.push_back(segment.output.get());
+    } else {
+      references[segment.output.get()] = 0;
+      reached.push_back(segment.output.get());
+    }
+    while (!ready.empty()) {
+      auto *node = ready.back();
+      ready.pop_back();
+      segment.order.push_back(node);
+      for (auto &child : node->children_) {
+        auto &count = references[child.get()];
+        if (count == 0) {
+          reached.push_back(child.get());
+        }
+        if (++count == child.use_count()) {
+          count = -1;
+          ready.push_back(child.get());
+        }
+      }
+    }
+
+    std::unordered_set<Node *> leaves;
+    for (auto &leaf : segment.leaves) {
+      leaves.insert(leaf.get());
+    }
+    for (auto *node : reached) {
+      if (references[node] != -1 && leaves.count(node) == 0) {
+        segment.captured.push_back(node);
+      }
+    }
+    return segment;
+  };
+  // Gradients cannot flow past a captured node into the graph it was
+  // computed from.
+  auto check_captured = [](const Segment &segment) {
+    for (auto *node : segment.captured) {
+      if (!node->children_.empty()) {
+        throw std::invalid_argument(
+            "Checkpoint segments may only capture leaf nodes");
+      }
+    }
+  };
+
+  // Record the segment once to check what it captures. Only its output is
+  // kept.
+  T output_data;
+  {
+    auto segment = record(inputs);
+    check_captured(segment);
+    output_data = segment.output->data_;
+  }
+
+  ProfileOpScope profile(Node::Op::kCustom);
+  auto result = Node::CreateGradnode(output_data, "");
+  result->op_ = Node::Op::kCustom;
+  result->children_ = inputs;
+  result->backward_fn_ = [record, check_captured, result = result.get()]() {
+    auto segment = record(result->children_);
+    // fn may capture other nodes than it did at construction. Fail before
+    // any gradient leaves the segment.
+    check_captured(segment);
+
+    // Differentiate the nodes fn created. The gradients of the input copies
+    // and the captured nodes are collected instead, and contributions reach
+    // the graph outside the segment only through PropagateGrad().
+    std::unordered_map<Node *, G> grads; // Of the nodes not visited yet.
+    std::vector<std::pair<Node *, G>> contributions;
+    grads[segment.output.get()] = result->grad_;
+    {
+      GradSinkScope<Node, G> sink(&contributions);
+      for (auto *node : segment.order) {
+        auto found = grads.find(node);
+        node->grad_ = found != grads.end() ? found->second : G(0);
+        if (found != grads.end()) {
+          grads.erase(found);
+        }
+        contributions.clear();
+        if (node->backward_fn_ != nullptr) {
+          node->backward_fn_();
+        }
+        for (auto &contribution : contributions) {
+          grads[contribution.first] += contribution.second;
+        }
+      }
+    }
+
+    for (size_t i = 0; i < segment.leaves.size(); i++) {
+      auto found = grads.find(segment.leaves[i].get());
+      auto *input = result->children_[i].get();
+      if (found != grads.end() && !input->is_scalar_) {
+        Node::PropagateGrad(input, found->second);
+      }
+    }
+    for (auto *captured : segment.captured) {
+      auto found = grads.find(captured);
+      if (found != grads.end()) {
+        Node::PropagateGrad(captured, found->second);
+      }
+    }
+  };
+  return result;
+}
+
+std::shared_ptr<GradNode>
+Sum(const std::vector<std::shared_ptr<GradNode>> &xs) {
+  return Sum<double, double>(xs);
+}
+
+std::shared_ptr<GradNode>
+Dot(const std::vector<std::shared_ptr<GradNode>> &a,
+    const std::vector<std::shared_ptr<GradNode>> &b) {
+  return Dot<double, double>(a, b);
+}
+
+std::shared_ptr<GradNode>
+Dot(const std::vector<std::shared_ptr<GradNode>> &a,
+    const std::vector<double> &b) {
+  return Dot<double, double>(a, b);
+}
+
+std::shared_ptr<GradNode>
+Checkpoint(const CheckpointFn<double> &fn,
+           const std::vector<std::shared_ptr<GradNode>> &inputs) {
+  return Checkpoint<double, double>(fn, inputs);
+}
+
+// Instantiates the node class and its operators for one pair of value and
+// gradient types.
+#define MICROGRAD_INSTANTIATE(T, G)                                            \
+  template class BasicGradNode<T, G>;                                          \
+  template std::shared_ptr<BasicGradNode<T, G>> operator+(                     \
+      T, const std::shared_ptr<BasicGradNode<T, G>> &);                        \
+  template std::shared_ptr<BasicGradNode<T, G>> operator+(                     \
+      const std::shared_ptr<BasicGradNode<T, G>> &, T);                        \
+  template std::shared_ptr<BasicGradNode<T, G>> operator+(                     \
+      const std::shared_ptr<BasicGradNode<T, G>> &,                            \
+      const std::shared_ptr<BasicGradNode<T, G>> &);                           \
+  template std::shared_ptr<BasicGradNode<T, G>> operator-(                     \
+      T, const std::shared_ptr<BasicGradNode<T, G>> &);                        \
+  template std::shared_ptr<BasicGradNode<T, G>> operator-(                     \
+      const std::shared_ptr<BasicGradNode<T, G>> &, T);                        \
+  template std::shared_ptr<BasicGradNode<T, G>> operator-(                     \
+      const std::shared_ptr<BasicGradNode<T, G>> &,                            \
+      const std::shared_ptr<BasicGradNode<T, G>> &);                           \
+  template std::shared_ptr<BasicGradNode<T, G>> operator*(                     \
+      T, const std::shared_ptr<BasicGradNode<T, G>> &);                        \
+  template std::shared_ptr<BasicGradNode<T, G>> operator*(                     \
+      const std::shared_ptr<BasicGradNode<T, G>> &, T);                        \
+  template std::shared_ptr<BasicGradNode<T, G>> operator*(                     \
+      const std::shared_ptr<BasicGradNode<T, G>> &,                            \
+      const std::shared_ptr<BasicGradNode<T, G>> &);                           \
+  template std::shared_ptr<BasicGradNode<T, G>> operator/(                     \
+      T, const std::shared_ptr<BasicGradNode<T, G>> &);                        \
+  template std::shared_ptr<BasicGradNode<T, G>> operator/(                     \
+      const std::shared_ptr<BasicGradNode<T, G>> &, T);                        \
+  template std::shared_ptr<BasicGradNode<T, G>> operator/(                     \
+      const std::shared_ptr<BasicGradNode<T, G>> &,                            \
+      const std::shared_ptr<BasicGradNode<T, G>> &);                           \
+  template std::shared_ptr<BasicGradNode<T, G>> pow(                           \
+      std::shared_ptr<BasicGradNode<T, G>> &, T);                              \
+  template std::shared_ptr<BasicGradNode<T, G>> pow(                           \
+      std::shared_ptr<BasicGradNode<T, G>> &,                                  \
+      std::shared_ptr<BasicGradNode<T, G>> &);                                 \
+  template std::shared_ptr<BasicGradNode<T, G>> log(                           \
+      std::shared_ptr<BasicGradNode<T, G>> &);                                 \
+  template std::shared_ptr<BasicGradNode<T, G>> sigmoid(                       \
+      std::shared_ptr<BasicGradNode<T, G>> &);                                 \
+  template std::shared_ptr<BasicGradNode<T, G>> tanh(                          \
+      std::shared_ptr<BasicGradNode<T, G>> &);                                 \
+  template std::shared_ptr<BasicGradNode<T, G>> relu(                          \
+      std::shared_ptr<BasicGradNode<T, G>> &);                                 \
+  template std::shared_ptr<BasicGradNode<T, G>> Sum(                           \
+      const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &);              \
+  template std::shared_ptr<BasicGradNode<T, G>> Dot(                           \
+      const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &,               \
+      const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &);              \
+  template std::shared_ptr<BasicGradNode<T, G>> Dot(                           \
+      const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &,               \
+      const std::vector<T> &);                                                 \
+  template std::shared_ptr<BasicGradNode<T, G>> Checkpoint(                    \
+      const CheckpointFn<T, G> &,                                              \
+      const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &)
+
+MICROGRAD_INSTANTIATE(double, double);
+MICROGRAD_INSTANTIATE(float, float);
+MICROGRAD_INSTANTIATE(float, double);
+
+#undef MICROGRAD_INSTANTIATE
+
 } // namespace micrograd
-} // namespace apexkid
\ No newline at end of file
+} // namespace apexkid
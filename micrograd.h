@@ -1,27 +1,152 @@
 #ifndef MICROGRAD_H
 #define MICROGRAD_H
 
+#include "graph.h"
+
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
-#include <set>
-#include <stack>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace apexkid {
 namespace micrograd {
 
+class ThreadPool;
+class StaticGraph;
+class GradientGraph;
+class CodeGenerator;
+class BatchGraph;
+
+template <typename T, typename G> class BasicGradNode;
+
+/// A function recomputed by Checkpoint(): it maps input nodes to an output.
+template <typename T, typename G = T>
+using CheckpointFn = std::function<std::shared_ptr<BasicGradNode<T, G>>(
+    const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &)>;
+
+namespace internal {
+
+template <typename T> struct TypeIdentity {
+  using type = T;
+};
+
+/// T in a context that does not take part in template argument deduction, so
+/// that `node + 2.0` works for float nodes.
+template <typename T> using NonDeduced = typename TypeIdentity<T>::type;
+
+} // namespace internal
+
+/**
+ * @class GradNodeBase
+ * @brief The state and definitions shared by the nodes of every scalar type.
+ */
+class GradNodeBase {
+public:
+  /// The operation that produced a node.
+  enum class Op : uint8_t {
+    kLeaf,
+    kCustom,
+    kAdd,
+    kSub,
+    kMul,
+    kDiv,
+    kPow,
+    kLog,
+    kSigmoid,
+    kTanh,
+    kRelu,
+    // Operations with a constant operand, stored in the node instead of in a
+    // child: x + c, x - c, c - x, x * c, x / c, c / x and x ^ c.
+    kAddConstant,
+    kSubConstant,
+    kRSubConstant,
+    kMulConstant,
+    kDivConstant,
+    kRDivConstant,
+    kPowConstant,
+    // Operations over any number of children: their sum, the dot product of
+    // the first and second halves of the children, and the dot product of
+    // the children with the constants in operands_.
+    kSum,
+    kDot,
+    kDotConstant,
+  };
+
+  /// The number of values of Op.
+  static constexpr size_t kNumOps = static_cast<size_t>(Op::kDotConstant) + 1;
+
+  /**
+   * @brief Gets the number of nodes of any scalar type currently alive.
+   * @return The number of live nodes.
+   */
+  static size_t LiveNodeCount();
+
+  /**
+   * @brief Checks whether operations on this thread record a graph.
+   * @return False while a NoGradGuard is active on this thread.
+   */
+  static bool IsGradEnabled();
+
+protected:
+  /// Nesting depth beyond which GetLabel() elides subexpressions.
+  static constexpr int kMaxLabelDepth = 32;
+
+  /// Smallest level that Backward(ThreadPool &) runs in parallel.
+  static constexpr size_t kMinParallelLevelSize = 256;
+
+  /// Number of nodes per parallel task in Backward(ThreadPool &).
+  static constexpr size_t kParallelChunkSize = 64;
+
+  /**
+   * @brief Counts a newly constructed node.
+   * @return The number of live nodes, including the new one.
+   */
+  static size_t AddLiveNode();
+
+  /**
+   * @brief Counts a destroyed node.
+   */
+  static void RemoveLiveNode();
+
+  /**
+   * @brief Gets the current graph generation, which changes whenever a graph
+   * is released and so invalidates cached sort orders.
+   * @return The generation.
+   */
+  static uint64_t GraphGeneration();
+
+  /**
+   * @brief Starts a new graph generation.
+   */
+  static void NextGraphGeneration();
+};
+
 /**
- * @class GradNode
+ * @class BasicGradNode
  * @brief Represents a node in a computational graph for automatic
  * differentiation.
  *
  * This class encapsulates a value (data), its gradient, and a backward function
  * for calculating gradients in a computational graph. GradNode objects can be
  * linked together to form a graph that supports forward and backward passes.
+ *
+ * Values have type T and gradients type G, which is T by default. The library
+ * is instantiated for double (GradNode), float (FloatGradNode), and float
+ * values with double gradients (MixedGradNode), which halves the size of the
+ * stored values while accumulating gradients in double precision. Nodes of
+ * different types cannot be combined in one graph.
  */
-class GradNode {
+template <typename T, typename G = T>
+class BasicGradNode : public GradNodeBase {
 public:
+  /// The type of the values.
+  using Value = T;
+  /// The type of the gradients.
+  using Gradient = G;
+
   /**
    * @brief Constructs a GradNode with data, label, children, and a backward
    * function.
@@ -31,16 +156,18 @@ public:
    * @param backward_fn A function that computes the gradient for the children
    * of this node.
    */
-  GradNode(double data, std::string label,
-           std::vector<std::shared_ptr<GradNode>> children,
-           std::function<void()> backward_fn);
+  BasicGradNode(T data, std::string label,
+                std::vector<std::shared_ptr<BasicGradNode>> children,
+                std::function<void()> backward_fn);
 
   /**
    * @brief Constructs a GradNode with data and label.
    * @param data The value of the node.
    * @param label A label to identify the node.
    */
-  GradNode(double data, std::string label);
+  BasicGradNode(T data, std::string label);
+
+  ~BasicGradNode();
 
   /**
    * @brief Converts the node to represent a scalar value.
@@ -51,26 +178,98 @@ public:
    * @brief Performs a backward pass to compute gradients.
    *
    * This method computes the gradients for all nodes in the graph starting
-   * from the current node.
+   * from the current node. Graphs that share nodes must not be
+   * differentiated concurrently, as their passes sort and update the shared
+   * nodes.
    */
   void Backward();
 
+  /**
+   * @brief Performs a backward pass, running independent nodes in parallel.
+   *
+   * Nodes are grouped into levels by their longest distance from this node,
+   * so all consumers of a node are on earlier levels. Levels are processed in
+   * order and wide levels are split into fixed-size chunks run on the pool.
+   * Contributions to a child that no other node of the level shares go
+   * straight to it. The others are buffered per chunk and added once the
+   * level is done, in chunk order, so the result does not depend on
+   * scheduling. Custom backward functions may add to any node, so all their
+   * contributions, including those made through AccumulateGrad(), are
+   * buffered. The levels are cached like the topological order, and a pool
+   * of one thread runs the serial Backward().
+   *
+   * Experimental: no speedup over Backward() has been measured yet. On a
+   * single core the level schedule costs about 1.2 times a serial pass, so
+   * prefer Backward() unless BM_BackwardParallel shows a win on the target
+   * machine. Custom backward functions must not start another parallel pass
+   * on the same pool, which makes ThreadPool::ParallelFor throw.
+   * @param pool The threads to run the pass on.
+   */
+  void Backward(ThreadPool &pool);
+
   /**
    * @brief Prints the structure of the computational graph.
    */
   void PrintNetwork();
 
+  /**
+   * @brief Detaches the computational graph below this node.
+   *
+   * Drops the children and backward function of this node and of every node
+   * below it that is only referenced from the released graph, so that
+   * intermediate nodes are freed even while this node or the leaves are still
+   * referenced. Nodes still held elsewhere, such as a subgraph shared with
+   * another root, keep their own graph. Gradients can no longer be propagated
+   * through the released nodes.
+   */
+  void ReleaseGraph();
+
   /**
    * @brief Gets the gradient value of the node.
    * @return The gradient value.
    */
-  double GetGrad();
+  G GetGrad();
+
+  /**
+   * @brief Gets the label of the node.
+   *
+   * Only leaves store a label. The label of any other node is rendered from
+   * the graph structure on demand, so building a graph never concatenates
+   * strings. Subexpressions nested deeper than kMaxLabelDepth are elided.
+   * @return The label.
+   */
+  std::string GetLabel() const;
 
   /**
    * @brief Gets the data value of the node.
    * @return The data value.
    */
-  double GetData();
+  T GetData();
+
+  /**
+   * @brief Sets the data value of the node.
+   *
+   * Meant for updating leaves such as model parameters in place. Nodes that
+   * were already computed from this one are not recomputed.
+   * @param data The new data value.
+   */
+  void SetData(T data);
+
+  /**
+   * @brief Resets the gradient value of the node to zero.
+   */
+  void ZeroGrad();
+
+  /**
+   * @brief Adds to the gradient value of the node.
+   *
+   * Meant for gradients computed outside this node's graph, such as the
+   * reduced result of data-parallel training, and for custom backward
+   * functions. Within a backward pass it adds like the built-in operators, so
+   * it is safe in Backward(ThreadPool &).
+   * @param grad The gradient to add.
+   */
+  void AccumulateGrad(G grad);
 
   /**
    * @brief Creates a GradNode with data and label.
@@ -78,8 +277,8 @@ public:
    * @param label A label to identify the node.
    * @return A shared pointer to the created GradNode.
    */
-  static std::shared_ptr<GradNode> CreateGradnode(double data,
-                                                  std::string label);
+  static std::shared_ptr<BasicGradNode> CreateGradnode(T data,
+                                                       std::string label);
 
   /**
    * @brief Creates a GradNode with data, label, children, and a backward
@@ -91,101 +290,400 @@ public:
    * of this node.
    * @return A shared pointer to the created GradNode.
    */
-  static std::shared_ptr<GradNode>
-  CreateGradnode(double data, std::string label,
-                 std::vector<std::shared_ptr<GradNode>> children,
+  static std::shared_ptr<BasicGradNode>
+  CreateGradnode(T data, std::string label,
+                 std::vector<std::shared_ptr<BasicGradNode>> children,
                  std::function<void()> backward_fn);
 
   // Overloaded operators for arithmetic operations
 
   /// Addition
-  friend std::shared_ptr<GradNode>
-  operator+(double a, const std::shared_ptr<GradNode> &b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator+(internal::NonDeduced<U> a,
+            const std::shared_ptr<BasicGradNode<U, H>> &b);
 
-  friend std::shared_ptr<GradNode> operator+(const std::shared_ptr<GradNode> &a,
-                                             double b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator+(const std::shared_ptr<BasicGradNode<U, H>> &a,
+            internal::NonDeduced<U> b);
 
-  friend std::shared_ptr<GradNode>
-  operator+(const std::shared_ptr<GradNode> &a,
-            const std::shared_ptr<GradNode> &b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator+(const std::shared_ptr<BasicGradNode<U, H>> &a,
+            const std::shared_ptr<BasicGradNode<U, H>> &b);
 
   /// Subtraction
-  friend std::shared_ptr<GradNode>
-  operator-(double a, const std::shared_ptr<GradNode> &b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator-(internal::NonDeduced<U> a,
+            const std::shared_ptr<BasicGradNode<U, H>> &b);
 
-  friend std::shared_ptr<GradNode> operator-(const std::shared_ptr<GradNode> &a,
-                                             double b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator-(const std::shared_ptr<BasicGradNode<U, H>> &a,
+            internal::NonDeduced<U> b);
 
-  friend std::shared_ptr<GradNode>
-  operator-(const std::shared_ptr<GradNode> &a,
-            const std::shared_ptr<GradNode> &b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator-(const std::shared_ptr<BasicGradNode<U, H>> &a,
+            const std::shared_ptr<BasicGradNode<U, H>> &b);
 
   /// Multiplication
-  friend std::shared_ptr<GradNode>
-  operator*(double a, const std::shared_ptr<GradNode> &b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator*(internal::NonDeduced<U> a,
+            const std::shared_ptr<BasicGradNode<U, H>> &b);
 
-  friend std::shared_ptr<GradNode> operator*(const std::shared_ptr<GradNode> &a,
-                                             double b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator*(const std::shared_ptr<BasicGradNode<U, H>> &a,
+            internal::NonDeduced<U> b);
 
-  friend std::shared_ptr<GradNode>
-  operator*(const std::shared_ptr<GradNode> &a,
-            const std::shared_ptr<GradNode> &b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator*(const std::shared_ptr<BasicGradNode<U, H>> &a,
+            const std::shared_ptr<BasicGradNode<U, H>> &b);
 
   /// Division
-  friend std::shared_ptr<GradNode>
-  operator/(double a, const std::shared_ptr<GradNode> &b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator/(internal::NonDeduced<U> a,
+            const std::shared_ptr<BasicGradNode<U, H>> &b);
 
-  friend std::shared_ptr<GradNode> operator/(const std::shared_ptr<GradNode> &a,
-                                             double b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator/(const std::shared_ptr<BasicGradNode<U, H>> &a,
+            internal::NonDeduced<U> b);
 
-  friend std::shared_ptr<GradNode>
-  operator/(const std::shared_ptr<GradNode> &a,
-            const std::shared_ptr<GradNode> &b);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  operator/(const std::shared_ptr<BasicGradNode<U, H>> &a,
+            const std::shared_ptr<BasicGradNode<U, H>> &b);
 
   /// Power
-  friend std::shared_ptr<GradNode> pow(std::shared_ptr<GradNode> &base,
-                                       double exponent);
-  friend std::shared_ptr<GradNode> pow(std::shared_ptr<GradNode> &base,
-                                       std::shared_ptr<GradNode> &exponent);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  pow(std::shared_ptr<BasicGradNode<U, H>> &base,
+      internal::NonDeduced<U> exponent);
+
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  pow(std::shared_ptr<BasicGradNode<U, H>> &base,
+      std::shared_ptr<BasicGradNode<U, H>> &exponent);
 
   /// Log
-  friend std::shared_ptr<GradNode> log(std::shared_ptr<GradNode> &x);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  log(std::shared_ptr<BasicGradNode<U, H>> &x);
 
   /// Sigmoid
-  friend std::shared_ptr<GradNode> sigmoid(std::shared_ptr<GradNode> &x);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  sigmoid(std::shared_ptr<BasicGradNode<U, H>> &x);
 
   /// Tanh
-  friend std::shared_ptr<GradNode> tanh(std::shared_ptr<GradNode> &x);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  tanh(std::shared_ptr<BasicGradNode<U, H>> &x);
 
   /// ReLU
-  friend std::shared_ptr<GradNode> relu(std::shared_ptr<GradNode> &x);
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  relu(std::shared_ptr<BasicGradNode<U, H>> &x);
+
+  // Reductions computed by a single node
+
+  /// Sum of a list of nodes.
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  Sum(const std::vector<std::shared_ptr<BasicGradNode<U, H>>> &xs);
+
+  /// Dot product of two lists of nodes of the same length.
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  Dot(const std::vector<std::shared_ptr<BasicGradNode<U, H>>> &a,
+      const std::vector<std::shared_ptr<BasicGradNode<U, H>>> &b);
+
+  /// Dot product of a list of nodes with constants of the same length.
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  Dot(const std::vector<std::shared_ptr<BasicGradNode<U, H>>> &a,
+      const std::vector<internal::NonDeduced<U>> &b);
+
+  /// A segment recomputed during the backward pass. See Checkpoint().
+  template <typename U, typename H>
+  friend std::shared_ptr<BasicGradNode<U, H>>
+  Checkpoint(const internal::NonDeduced<CheckpointFn<U, H>> &fn,
+             const std::vector<std::shared_ptr<BasicGradNode<U, H>>> &inputs);
 
 private:
+  /**
+   * @brief Adds a gradient contribution to a child during a backward pass.
+   *
+   * Contributions go straight to the child, or to the calling thread's buffer
+   * while a parallel backward pass or a checkpointed segment runs on it.
+   * @param node The child receiving the contribution.
+   * @param grad The contribution.
+   */
+  static void PropagateGrad(BasicGradNode *node, G grad);
+
+  friend class StaticGraph;
+  friend class GradientGraph;
+  friend class CodeGenerator;
+  friend class BatchGraph;
+
+  /**
+   * @brief Recomputes the data value of the node from its children.
+   *
+   * Leaves and custom nodes keep their data value.
+   */
+  void Recompute();
+
+  /**
+   * @brief Renders the label of the node.
+   * @param depth The number of nested levels that may still be rendered.
+   * @return The label.
+   */
+  std::string RenderLabel(int depth) const;
+
+  template <typename Node>
+  friend void internal::TopologicalSort(Node *root, std::vector<Node *> *order);
+
   /**
    * @brief Performs a topological sort of the computational graph.
-   * @return A stack of pointers to GradNode objects in topological order.
+   *
+   * The order is cached on this node and reused until a graph is released.
+   * @return The nodes of the graph with every child before its parents, so
+   * this node comes last.
    */
-  std::stack<const GradNode *> TopologicalSort();
+  const std::vector<BasicGradNode *> &TopologicalSort();
+
+  /// Gradient contributions buffered by a parallel backward pass.
+  using Contributions = std::vector<std::pair<BasicGradNode *, G>>;
+
+  /// The nodes of a graph grouped by level for Backward(ThreadPool &).
+  struct BackwardLevels {
+    std::vector<BasicGradNode *> nodes; // Level 0 first.
+    // Where each level starts in nodes, followed by the number of nodes.
+    std::vector<size_t> level_begin;
+    uint64_t generation = 0; // The graph generation the levels are valid for.
+    // The children of more than one node of some level.
+    std::vector<BasicGradNode *> shared;
+    // The buffered gradient contributions of each chunk. Kept between passes
+    // to reuse their memory.
+    std::vector<Contributions> sinks;
+  };
 
   /**
-   * @brief Utility function for topological sort.
-   * @param node The current node.
-   * @param stack The stack to store the topological order.
-   * @param visited A set of visited nodes.
+   * @brief Groups the nodes of the graph by level.
+   *
+   * The levels are cached on this node and reused until a graph is released.
+   * @return The nodes of the graph grouped by level, the children they share
+   * within a level, and the buffers of the parallel backward pass.
    */
-  void TopologicalSortUtil(const GradNode &node,
-                           std::stack<const GradNode *> &stack,
-                           std::set<const GradNode *> &visited);
+  BackwardLevels &GetBackwardLevels();
 
   /// Private members
-  std::vector<std::shared_ptr<GradNode>> children_; // Child nodes.
-  std::function<void()> backward_fn_; // Backward function to compute gradients.
-  double data_;                       // The value of the node.
-  double grad_ = 0.0;                 // The gradient of the node.
-  std::string label_;                 // The label of the node.
+  std::vector<std::shared_ptr<BasicGradNode>> children_; // Child nodes.
+  // Backward function to compute gradients. It only captures raw pointers, as
+  // the node keeps its children alive and must not keep itself alive.
+  std::function<void()> backward_fn_;
+  T data_;                            // The value of the node.
+  G grad_ = G(0);                     // The gradient of the node.
+  std::string label_;                 // The label given to the node, if any.
+  Op op_ = Op::kLeaf;                 // The operation that produced the node.
+  T operand_ = T(0); // The constant operand of a k*Constant operation.
+  std::vector<T> operands_; // The constants of a kDotConstant operation.
   bool is_scalar_ = false; // Indicates if the node represents a scalar value.
+  // Set while a parallel backward pass runs if nodes of one level share this
+  // node as a child.
+  bool shared_child_ = false;
+  uint64_t visit_epoch_ = 0; // Epoch of the last sort that visited the node.
+  // Level of the node in a parallel backward pass, while GetBackwardLevels()
+  // runs.
+  size_t backward_level_ = 0;
+  // Cached result of TopologicalSort() and the graph generation it is valid
+  // for.
+  std::vector<BasicGradNode *> topological_order_;
+  uint64_t topological_order_generation_ = 0;
+  // Cached result of GetBackwardLevels(), only allocated for the roots of
+  // parallel backward passes.
+  std::unique_ptr<BackwardLevels> backward_levels_;
 };
 
+/// A node with double values and gradients.
+using GradNode = BasicGradNode<double>;
+/// A node with float values and gradients.
+using FloatGradNode = BasicGradNode<float>;
+/// A node with float values and double gradients.
+using MixedGradNode = BasicGradNode<float, double>;
+
+/**
+ * @class NoGradGuard
+ * @brief Disables graph construction on the current thread while in scope.
+ *
+ * While a guard is alive, every operator returns a detached leaf holding only
+ * the result value: no children, backward function or label are created.
+ * Use it for evaluation and inference, where only GetData() is needed.
+ */
+class NoGradGuard {
+public:
+  NoGradGuard();
+  ~NoGradGuard();
+
+  NoGradGuard(const NoGradGuard &) = delete;
+  NoGradGuard &operator=(const NoGradGuard &) = delete;
+
+private:
+  bool previous_; // Whether gradients were enabled when the guard was created.
+};
+
+/**
+ * @class EnableGradGuard
+ * @brief Enables graph construction on the current thread while in scope.
+ *
+ * Overrides an enclosing NoGradGuard, for code that must record a graph to
+ * do its work, such as differentiating a gradient.
+ */
+class EnableGradGuard {
+public:
+  EnableGradGuard();
+  ~EnableGradGuard();
+
+  EnableGradGuard(const EnableGradGuard &) = delete;
+  EnableGradGuard &operator=(const EnableGradGuard &) = delete;
+
+private:
+  bool previous_; // Whether gradients were enabled when the guard was created.
+};
+
+// Namespace-scope declarations of the operators. The double overloads of the
+// reductions also accept braced lists of nodes, from which no template
+// arguments can be deduced.
+
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator+(internal::NonDeduced<T> a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator+(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          internal::NonDeduced<T> b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator+(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator-(internal::NonDeduced<T> a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator-(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          internal::NonDeduced<T> b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator-(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator*(internal::NonDeduced<T> a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator*(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          internal::NonDeduced<T> b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator*(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator/(internal::NonDeduced<T> a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator/(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          internal::NonDeduced<T> b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+operator/(const std::shared_ptr<BasicGradNode<T, G>> &a,
+          const std::shared_ptr<BasicGradNode<T, G>> &b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+pow(std::shared_ptr<BasicGradNode<T, G>> &base,
+    internal::NonDeduced<T> exponent);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+pow(std::shared_ptr<BasicGradNode<T, G>> &base,
+    std::shared_ptr<BasicGradNode<T, G>> &exponent);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+log(std::shared_ptr<BasicGradNode<T, G>> &x);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+sigmoid(std::shared_ptr<BasicGradNode<T, G>> &x);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+tanh(std::shared_ptr<BasicGradNode<T, G>> &x);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+relu(std::shared_ptr<BasicGradNode<T, G>> &x);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+Sum(const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &xs);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+Dot(const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &a,
+    const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &b);
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+Dot(const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &a,
+    const std::vector<internal::NonDeduced<T>> &b);
+
+/**
+ * @brief Evaluates a segment of a graph without keeping its interior nodes.
+ *
+ * Runs fn on copies of the inputs and returns a single node holding the
+ * result, whose children are the inputs. The graph fn records is dropped
+ * once it has been checked. During the backward pass the node calls fn again
+ * on copies of the inputs, differentiates that temporary graph and passes
+ * the gradients on to the inputs. Splitting a chain of n operations into
+ * sqrt(n) checkpointed segments keeps about sqrt(n) nodes alive instead of n,
+ * for the cost of one more forward pass.
+ *
+ * fn is stored in the node and must give the same result when called again:
+ * capture by value anything it reads. Captured leaf nodes, such as
+ * parameters, receive their gradients as if they were inputs; nodes computed
+ * from them must be passed as inputs instead, or Checkpoint() throws
+ * std::invalid_argument.
+ * @param fn The segment, taking the inputs in order.
+ * @param inputs The nodes the segment depends on.
+ * @return The node holding the output of the segment.
+ */
+template <typename T, typename G>
+std::shared_ptr<BasicGradNode<T, G>>
+Checkpoint(const internal::NonDeduced<CheckpointFn<T, G>> &fn,
+           const std::vector<std::shared_ptr<BasicGradNode<T, G>>> &inputs);
+
+std::shared_ptr<GradNode>
+Sum(const std::vector<std::shared_ptr<GradNode>> &xs);
+std::shared_ptr<GradNode>
+Dot(const std::vector<std::shared_ptr<GradNode>> &a,
+    const std::vector<std::shared_ptr<GradNode>> &b);
+std::shared_ptr<GradNode>
+Dot(const std::vector<std::shared_ptr<GradNode>> &a,
+    const std::vector<double> &b);
+std::shared_ptr<GradNode>
+Checkpoint(const CheckpointFn<double> &fn,
+           const std::vector<std::shared_ptr<GradNode>> &inputs);
+
+// The operators are defined in micrograd.cc for the node types above.
+extern template class BasicGradNode<double>;
+extern template class BasicGradNode<float>;
+extern template class BasicGradNode<float, double>;
+
 } // namespace micrograd
 } // namespace apexkid
 
@@ -0,0 +1,568 @@
+#include "batch_graph.h"
+#include "benchmark/benchmark.h"
+#include "expression.h"
+#include "graph.h"
+#include "micrograd.h"
+#include "optimizer.h"
+#include "parameter.h"
+#include "static_graph.h"
+#include "thread_pool.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Benchmarks of the core GradNode paths: node creation, every operator,
+// sorting and differentiating large graphs, and the demo training loops, the
+// latter also with the expression templates of expression.h, and the
+// gradient of the demo loss over a data set, with StaticGraph and BatchGraph.
+// Every benchmark also reports the heap allocations and bytes allocated per
+// iteration, counted by the global operator new below.
+//
+// Usage: bazel run -c opt //:micrograd_benchmark
+
+namespace {
+
+std::atomic<size_t> allocation_count{0};
+std::atomic<size_t> allocation_bytes{0};
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (auto *pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+// Kept out of line: inlining free() into delete-expressions makes GCC warn
+// about mismatched allocation functions.
+[[gnu::noinline]] void operator delete(void *pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+  operator delete(pointer);
+}
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+/// Reports the allocations made since construction as per-iteration counters.
+class AllocationCounter {
+public:
+  explicit AllocationCounter(benchmark::State &state)
+      : state_(state),
+        count_(allocation_count.load(std::memory_order_relaxed)),
+        bytes_(allocation_bytes.load(std::memory_order_relaxed)) {}
+
+  ~AllocationCounter() {
+    auto count = allocation_count.load(std::memory_order_relaxed) - count_;
+    auto bytes = allocation_bytes.load(std::memory_order_relaxed) - bytes_;
+    state_.counters["allocs"] =
+        benchmark::Counter(count, benchmark::Counter::kAvgIterations);
+    state_.counters["bytes"] =
+        benchmark::Counter(bytes, benchmark::Counter::kAvgIterations);
+  }
+
+private:
+  benchmark::State &state_;
+  size_t count_;
+  size_t bytes_;
+};
+
+// Node creation
+
+void BM_CreateLeaf(benchmark::State &state) {
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    auto node = GradNode::CreateGradnode(1.0, "");
+    benchmark::DoNotOptimize(node);
+  }
+}
+BENCHMARK(BM_CreateLeaf);
+
+void BM_CreateLabeledLeaf(benchmark::State &state) {
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    auto node = GradNode::CreateGradnode(1.0, "a long parameter label");
+    benchmark::DoNotOptimize(node);
+  }
+}
+BENCHMARK(BM_CreateLabeledLeaf);
+
+// Operators: each iteration builds and frees one node over two leaves.
+
+template <typename Fn> void RunBinaryOp(benchmark::State &state, Fn fn) {
+  auto a = GradNode::CreateGradnode(0.75, "a");
+  auto b = GradNode::CreateGradnode(1.25, "b");
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    auto node = fn(a, b);
+    benchmark::DoNotOptimize(node);
+  }
+}
+
+using Node = std::shared_ptr<GradNode>;
+
+void BM_Add(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &b) { return a + b; });
+}
+BENCHMARK(BM_Add);
+
+void BM_AddConstant(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &) { return a + 2.0; });
+}
+BENCHMARK(BM_AddConstant);
+
+void BM_Sub(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &b) { return a - b; });
+}
+BENCHMARK(BM_Sub);
+
+void BM_Mul(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &b) { return a * b; });
+}
+BENCHMARK(BM_Mul);
+
+void BM_MulConstant(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &) { return a * 2.0; });
+}
+BENCHMARK(BM_MulConstant);
+
+void BM_Div(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &b) { return a / b; });
+}
+BENCHMARK(BM_Div);
+
+void BM_Pow(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &b) { return pow(a, b); });
+}
+BENCHMARK(BM_Pow);
+
+void BM_PowConstant(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &) { return pow(a, 2.0); });
+}
+BENCHMARK(BM_PowConstant);
+
+void BM_Log(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &) { return log(a); });
+}
+BENCHMARK(BM_Log);
+
+void BM_Sigmoid(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &) { return sigmoid(a); });
+}
+BENCHMARK(BM_Sigmoid);
+
+void BM_Tanh(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &) { return tanh(a); });
+}
+BENCHMARK(BM_Tanh);
+
+void BM_Relu(benchmark::State &state) {
+  RunBinaryOp(state, [](Node &a, Node &) { return relu(a); });
+}
+BENCHMARK(BM_Relu);
+
+void BM_Dot(benchmark::State &state) {
+  std::vector<Node> a;
+  std::vector<double> b;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    a.push_back(GradNode::CreateGradnode(0.5, ""));
+    b.push_back(1.5);
+  }
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    auto node = Dot(a, b);
+    benchmark::DoNotOptimize(node);
+  }
+}
+BENCHMARK(BM_Dot)->Arg(4)->Arg(64)->Arg(1024);
+
+// Activations alone, without building nodes, to isolate the cost of the math.
+
+void BM_SigmoidValue(benchmark::State &state) {
+  auto x = GradNode::CreateGradnode(0.75, "x");
+  NoGradGuard no_grad;
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    auto node = sigmoid(x);
+    benchmark::DoNotOptimize(node);
+  }
+}
+BENCHMARK(BM_SigmoidValue);
+
+void BM_TanhValue(benchmark::State &state) {
+  auto x = GradNode::CreateGradnode(0.75, "x");
+  NoGradGuard no_grad;
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    auto node = tanh(x);
+    benchmark::DoNotOptimize(node);
+  }
+}
+BENCHMARK(BM_TanhValue);
+
+// Graphs of n nodes
+
+/// z = ((x * a) * a) * ... : every node depends on the previous one.
+Node BuildChain(int64_t n) {
+  auto a = GradNode::CreateGradnode(1.0, "a");
+  auto z = GradNode::CreateGradnode(1.0, "x");
+  for (int64_t i = 1; i < n; i++) {
+    z = z * a;
+  }
+  return z;
+}
+
+/// A balanced binary tree of additions over n / 2 leaves.
+Node BuildTree(int64_t n) {
+  std::vector<Node> level;
+  for (int64_t i = 0; i < n / 2; i++) {
+    level.push_back(GradNode::CreateGradnode(1.0, ""));
+  }
+  while (level.size() > 1) {
+    std::vector<Node> next;
+    for (size_t i = 0; i + 1 < level.size(); i += 2) {
+      next.push_back(level[i] + level[i + 1]);
+    }
+    if (level.size() % 2 == 1) {
+      next.push_back(level.back());
+    }
+    level = std::move(next);
+  }
+  return level[0];
+}
+
+/// n sigmoids of one shared leaf, summed by a single node.
+Node BuildWide(int64_t n) {
+  auto x = GradNode::CreateGradnode(0.5, "x");
+  std::vector<Node> terms;
+  for (int64_t i = 0; i < n; i++) {
+    terms.push_back(sigmoid(x));
+  }
+  return Sum(terms);
+}
+
+template <Node (*Build)(int64_t)> void BM_Build(benchmark::State &state) {
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    auto root = Build(state.range(0));
+    benchmark::DoNotOptimize(root);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <Node (*Build)(int64_t)> void BM_Sort(benchmark::State &state) {
+  auto root = Build(state.range(0));
+  std::vector<GradNode *> order;
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    internal::TopologicalSort(root.get(), &order);
+    benchmark::DoNotOptimize(order.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/// Backward with the sort order cached by a first pass.
+template <Node (*Build)(int64_t)> void BM_Backward(benchmark::State &state) {
+  auto root = Build(state.range(0));
+  std::vector<GradNode *> order;
+  internal::TopologicalSort(root.get(), &order);
+  root->Backward();
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    // Backward accumulates, so start every pass from zero gradients.
+    state.PauseTiming();
+    for (auto *node : order) {
+      node->ZeroGrad();
+    }
+    state.ResumeTiming();
+    root->Backward();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+#define GRAPH_BENCHMARK(name, build)                                           \
+  BENCHMARK_TEMPLATE(name, build)                                              \
+      ->RangeMultiplier(32)                                                    \
+      ->Range(1 << 10, 1 << 20)                                                \
+      ->Unit(benchmark::kMicrosecond)
+
+GRAPH_BENCHMARK(BM_Build, BuildChain);
+GRAPH_BENCHMARK(BM_Build, BuildTree);
+GRAPH_BENCHMARK(BM_Build, BuildWide);
+GRAPH_BENCHMARK(BM_Sort, BuildChain);
+GRAPH_BENCHMARK(BM_Sort, BuildTree);
+GRAPH_BENCHMARK(BM_Sort, BuildWide);
+GRAPH_BENCHMARK(BM_Backward, BuildChain);
+GRAPH_BENCHMARK(BM_Backward, BuildTree);
+GRAPH_BENCHMARK(BM_Backward, BuildWide);
+
+/// n terms tanh(w * x_i) * x_i of one shared weight, summed by a single
+/// node. Each level of the graph is n nodes wide.
+Node BuildTanhSum(int64_t n) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  std::vector<Node> terms;
+  for (int64_t i = 0; i < n; i++) {
+    auto x = GradNode::CreateGradnode(i / static_cast<double>(n), "");
+    auto z = w * x;
+    terms.push_back(tanh(z) * x);
+  }
+  return Sum(terms);
+}
+
+/// Backward(ThreadPool &) over a graph of 2^20 terms with the number of
+/// threads given by the argument. One thread runs the serial Backward().
+void BM_BackwardParallel(benchmark::State &state) {
+  auto root = BuildTanhSum(1 << 20);
+  std::vector<GradNode *> order;
+  internal::TopologicalSort(root.get(), &order);
+  ThreadPool pool(state.range(0));
+  root->Backward(pool);
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    // Backward accumulates, so start every pass from zero gradients.
+    state.PauseTiming();
+    for (auto *node : order) {
+      node->ZeroGrad();
+    }
+    state.ResumeTiming();
+    root->Backward(pool);
+  }
+  state.SetItemsProcessed(state.iterations() * order.size());
+}
+BENCHMARK(BM_BackwardParallel)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Demo training epochs over the linear regression data set.
+
+const std::vector<double> kX1 = {4, 2, 3, 1, 2, 8, 1, 9, 6, 1};
+const std::vector<double> kX2 = {3, 1, 4, 4, 2, 1, 2, 3, 2, 2};
+const std::vector<double> kX3 = {7, 7, 9, 3, 1, 6, 3, 5, 7, 5};
+const std::vector<double> kY = {33, 34, 35, 8.2, 7, 41.4, 13, 33, 39, 26};
+
+/// One epoch of SGD that builds a new graph per sample.
+void BM_LinearRegressionEpoch(benchmark::State &state) {
+  ParameterSet params;
+  auto w1 = params.Create(0.1, "w1");
+  auto w2 = params.Create(0.7, "w2");
+  auto w3 = params.Create(-0.4, "w3");
+  auto b = params.Create(0.0, "b");
+  Sgd optimizer(&params, 0.001);
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    for (size_t i = 0; i < kX1.size(); i++) {
+      optimizer.ZeroGrad();
+      auto pred = w1 * kX1[i] + w2 * kX2[i] + w3 * kX3[i] + b;
+      auto diff = pred - kY[i];
+      auto loss = pow(diff, 2);
+      loss->Backward();
+      optimizer.Step();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kX1.size());
+}
+BENCHMARK(BM_LinearRegressionEpoch);
+
+/// One epoch of SGD that replays a captured StaticGraph, as the demo does.
+void BM_LinearRegressionEpochStatic(benchmark::State &state) {
+  ParameterSet params;
+  auto w1 = params.Create(0.1, "w1");
+  auto w2 = params.Create(0.7, "w2");
+  auto w3 = params.Create(-0.4, "w3");
+  auto b = params.Create(0.0, "b");
+  Sgd optimizer(&params, 0.001);
+  auto x1 = GradNode::CreateGradnode(0.0, "x1");
+  auto x2 = GradNode::CreateGradnode(0.0, "x2");
+  auto x3 = GradNode::CreateGradnode(0.0, "x3");
+  auto y = GradNode::CreateGradnode(0.0, "y");
+  auto pred = Dot({w1, w2, w3}, {x1, x2, x3}) + b;
+  auto diff = pred - y;
+  StaticGraph graph(pow(diff, 2), {x1, x2, x3, y});
+  std::vector<std::vector<double>> samples;
+  for (size_t i = 0; i < kX1.size(); i++) {
+    samples.push_back({kX1[i], kX2[i], kX3[i], kY[i]});
+  }
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    for (auto &sample : samples) {
+      optimizer.ZeroGrad();
+      graph.Forward(sample);
+      graph.Backward();
+      optimizer.Step();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kX1.size());
+}
+BENCHMARK(BM_LinearRegressionEpochStatic);
+
+/// One epoch of the linear regression demo with expression templates.
+void BM_LinearRegressionEpochExpression(benchmark::State &state) {
+  std::array<double, 4> weights = {0.1, 0.7, -0.4, 0.0};
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    for (size_t i = 0; i < kX1.size(); i++) {
+      expr::Variable<0> w1(weights[0]);
+      expr::Variable<1> w2(weights[1]);
+      expr::Variable<2> w3(weights[2]);
+      expr::Variable<3> b(weights[3]);
+      auto loss = pow(w1 * kX1[i] + w2 * kX2[i] + w3 * kX3[i] + b - kY[i], 2);
+      auto grads = loss.Gradient();
+      for (size_t j = 0; j < weights.size(); j++) {
+        weights[j] -= 0.001 * grads[j];
+      }
+    }
+    benchmark::DoNotOptimize(weights);
+  }
+  state.SetItemsProcessed(state.iterations() * kX1.size());
+}
+BENCHMARK(BM_LinearRegressionEpochExpression);
+
+/// One epoch of the logistic regression demo, replaying a StaticGraph.
+void BM_LogisticRegressionEpochStatic(benchmark::State &state) {
+  const std::vector<double> labels = {1, 1, 1, 0, 0, 1, 0, 1, 1, 0};
+  ParameterSet params;
+  auto w1 = params.Create(0.1, "w1");
+  auto w2 = params.Create(0.7, "w2");
+  auto w3 = params.Create(-0.4, "w3");
+  auto b = params.Create(0.0, "b");
+  Sgd optimizer(&params, 0.001);
+  auto x1 = GradNode::CreateGradnode(0.0, "x1");
+  auto x2 = GradNode::CreateGradnode(0.0, "x2");
+  auto x3 = GradNode::CreateGradnode(0.0, "x3");
+  auto y = GradNode::CreateGradnode(0.0, "y");
+  auto z = Dot({w1, w2, w3}, {x1, x2, x3}) + b;
+  auto pred = sigmoid(z);
+  auto one_minus_pred = 1 - pred;
+  auto loss = (0.0 - y) * log(pred) - (1.0 - y) * log(one_minus_pred);
+  StaticGraph graph(loss, {x1, x2, x3, y});
+  std::vector<std::vector<double>> samples;
+  for (size_t i = 0; i < kX1.size(); i++) {
+    samples.push_back({kX1[i], kX2[i], kX3[i], labels[i]});
+  }
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    for (auto &sample : samples) {
+      optimizer.ZeroGrad();
+      graph.Forward(sample);
+      graph.Backward();
+      optimizer.Step();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kX1.size());
+}
+BENCHMARK(BM_LogisticRegressionEpochStatic);
+
+/// One epoch of the logistic regression demo with expression templates.
+void BM_LogisticRegressionEpochExpression(benchmark::State &state) {
+  const std::vector<double> labels = {1, 1, 1, 0, 0, 1, 0, 1, 1, 0};
+  std::array<double, 4> weights = {0.1, 0.7, -0.4, 0.0};
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    for (size_t i = 0; i < kX1.size(); i++) {
+      expr::Variable<0> w1(weights[0]);
+      expr::Variable<1> w2(weights[1]);
+      expr::Variable<2> w3(weights[2]);
+      expr::Variable<3> b(weights[3]);
+      auto pred = sigmoid(w1 * kX1[i] + w2 * kX2[i] + w3 * kX3[i] + b);
+      auto loss =
+          -labels[i] * log(pred) - (1.0 - labels[i]) * log(1.0 - pred);
+      auto grads = loss.Gradient();
+      for (size_t j = 0; j < weights.size(); j++) {
+        weights[j] -= 0.001 * grads[j];
+      }
+    }
+    benchmark::DoNotOptimize(weights);
+  }
+  state.SetItemsProcessed(state.iterations() * kX1.size());
+}
+BENCHMARK(BM_LogisticRegressionEpochExpression);
+
+/// The samples of the linear regression data set, repeated to 1024.
+std::vector<std::vector<double>> LinearRegressionSamples() {
+  std::vector<std::vector<double>> samples;
+  for (size_t i = 0; i < 1024; i++) {
+    auto j = i % kX1.size();
+    samples.push_back({kX1[j], kX2[j], kX3[j], kY[j]});
+  }
+  return samples;
+}
+
+/// The gradient of the linear regression loss over a data set, replaying a
+/// StaticGraph for each sample.
+void BM_LinearRegressionGradientStatic(benchmark::State &state) {
+  auto w1 = GradNode::CreateGradnode(0.1, "w1");
+  auto w2 = GradNode::CreateGradnode(0.7, "w2");
+  auto w3 = GradNode::CreateGradnode(-0.4, "w3");
+  auto b = GradNode::CreateGradnode(0.0, "b");
+  auto x1 = GradNode::CreateGradnode(0.0, "x1");
+  auto x2 = GradNode::CreateGradnode(0.0, "x2");
+  auto x3 = GradNode::CreateGradnode(0.0, "x3");
+  auto y = GradNode::CreateGradnode(0.0, "y");
+  auto pred = Dot({w1, w2, w3}, {x1, x2, x3}) + b;
+  auto diff = pred - y;
+  StaticGraph graph(pow(diff, 2), {x1, x2, x3, y});
+  auto samples = LinearRegressionSamples();
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    for (auto &sample : samples) {
+      graph.Forward(sample);
+      graph.Backward();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_LinearRegressionGradientStatic);
+
+/// The same gradient with a BatchGraph of the batch size given by the
+/// argument.
+void BM_LinearRegressionGradientBatch(benchmark::State &state) {
+  auto w1 = GradNode::CreateGradnode(0.1, "w1");
+  auto w2 = GradNode::CreateGradnode(0.7, "w2");
+  auto w3 = GradNode::CreateGradnode(-0.4, "w3");
+  auto b = GradNode::CreateGradnode(0.0, "b");
+  auto x1 = GradNode::CreateGradnode(0.0, "x1");
+  auto x2 = GradNode::CreateGradnode(0.0, "x2");
+  auto x3 = GradNode::CreateGradnode(0.0, "x3");
+  auto y = GradNode::CreateGradnode(0.0, "y");
+  auto pred = Dot({w1, w2, w3}, {x1, x2, x3}) + b;
+  auto diff = pred - y;
+  size_t batch_size = state.range(0);
+  BatchGraph graph(pow(diff, 2), {x1, x2, x3, y}, batch_size);
+  auto samples = LinearRegressionSamples();
+  std::vector<std::vector<std::vector<double>>> batches;
+  for (size_t i = 0; i < samples.size(); i += batch_size) {
+    batches.emplace_back(samples.begin() + i,
+                         samples.begin() + i + batch_size);
+  }
+  AllocationCounter counter(state);
+  for (auto _ : state) {
+    for (auto &batch : batches) {
+      graph.Forward(batch);
+      graph.Backward();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_LinearRegressionGradientBatch)->Arg(1)->Arg(8)->Arg(16);
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
+
+BENCHMARK_MAIN();
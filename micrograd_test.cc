@@ -1,6 +1,13 @@
 #include "micrograd.h"
 #include "gtest/gtest.h"
 
+#include "thread_pool.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
 namespace apexkid {
 namespace micrograd {
 namespace {
@@ -270,6 +277,28 @@ TEST(Micrograd, Tanh) {
   EXPECT_NEAR(z->GetData(), 0.9640275800758169, 1e-9);
 }
 
+TEST(Micrograd, SigmoidLargeInput) {
+  auto a = GradNode::CreateGradnode(-1000.0, "a");
+  auto b = GradNode::CreateGradnode(1000.0, "b");
+
+  auto z = sigmoid(a) + sigmoid(b);
+  z->Backward();
+
+  EXPECT_EQ(a->GetGrad(), 0.0);
+  EXPECT_EQ(b->GetGrad(), 0.0);
+  EXPECT_EQ(z->GetData(), 1.0);
+}
+
+TEST(Micrograd, TanhLargeInput) {
+  auto a = GradNode::CreateGradnode(-1000.0, "a");
+
+  auto z = tanh(a);
+  z->Backward();
+
+  EXPECT_EQ(a->GetGrad(), 0.0);
+  EXPECT_EQ(z->GetData(), -1.0);
+}
+
 TEST(Micrograd, Relu) {
   auto a = GradNode::CreateGradnode(-2.0, "a");
 
@@ -310,6 +339,405 @@ TEST(Micrograd, NegativeReluWithEquation) {
   EXPECT_EQ(z->GetData(), 0);
 }
 
+TEST(Micrograd, GraphIsFreed) {
+  auto live_nodes = GradNode::LiveNodeCount();
+  {
+    auto a = GradNode::CreateGradnode(2.0, "a");
+    auto b = GradNode::CreateGradnode(3.0, "b");
+    auto z = sigmoid(a) * pow(b, 2.0) + log(a) / b;
+    z->Backward();
+    EXPECT_GT(GradNode::LiveNodeCount(), live_nodes);
+  }
+  EXPECT_EQ(GradNode::LiveNodeCount(), live_nodes);
+}
+
+TEST(Micrograd, ReleaseGraph) {
+  auto live_nodes = GradNode::LiveNodeCount();
+  auto a = GradNode::CreateGradnode(2.0, "a");
+  auto z = (a * a + 3.0) / a;
+  z->Backward();
+  z->ReleaseGraph();
+
+  EXPECT_EQ(GradNode::LiveNodeCount(), live_nodes + 2);
+  EXPECT_EQ(a->GetGrad(), 1.0 - 3.0 / 4.0);
+  EXPECT_EQ(z->GetData(), 3.5);
+}
+
+// Releasing one root leaves the subgraph it shares with another root intact.
+TEST(Micrograd, ReleaseGraphKeepsSharedSubgraph) {
+  auto a = GradNode::CreateGradnode(2.0, "a");
+  std::shared_ptr<GradNode> z1;
+  std::shared_ptr<GradNode> z2;
+  {
+    auto shared = a * a + 1.0;
+    z1 = shared * 3.0;
+    z2 = shared * 2.0;
+  }
+  z1->ReleaseGraph();
+  z2->Backward();
+
+  EXPECT_EQ(a->GetGrad(), 2.0 * 2.0 * 2.0);
+}
+
+TEST(Micrograd, DeepChainIsFreed) {
+  auto live_nodes = GradNode::LiveNodeCount();
+  {
+    auto a = GradNode::CreateGradnode(1.0, "a");
+    auto z = a;
+    for (int i = 0; i < 20000; i++) {
+      z = z + a;
+    }
+    EXPECT_EQ(z->GetData(), 20001.0);
+  }
+  EXPECT_EQ(GradNode::LiveNodeCount(), live_nodes);
+}
+
+TEST(Micrograd, DeepChainBackward) {
+  auto a = GradNode::CreateGradnode(1.0, "a");
+  auto z = a;
+  for (int i = 0; i < 20000; i++) {
+    z = z * 1.0 + a;
+  }
+  z->Backward();
+
+  EXPECT_EQ(a->GetGrad(), 20001.0);
+  EXPECT_EQ(z->GetData(), 20001.0);
+}
+
+TEST(Micrograd, RepeatedBackwardAfterRelease) {
+  auto a = GradNode::CreateGradnode(2.0, "a");
+  auto b = GradNode::CreateGradnode(3.0, "b");
+  auto c = a * b;
+  auto z = c + a;
+  z->PrintNetwork();
+  z->Backward();
+  EXPECT_EQ(a->GetGrad(), 4.0);
+
+  // Releasing a subgraph must not leave stale nodes in the cached order.
+  c->ReleaseGraph();
+  z->Backward();
+  EXPECT_EQ(a->GetGrad(), 5.0);
+  EXPECT_EQ(b->GetGrad(), 2.0);
+}
+
+TEST(Micrograd, NoGradGuard) {
+  auto a = GradNode::CreateGradnode(2.0, "a");
+  auto b = GradNode::CreateGradnode(3.0, "b");
+  auto live_nodes = GradNode::LiveNodeCount();
+  {
+    NoGradGuard no_grad;
+    EXPECT_FALSE(GradNode::IsGradEnabled());
+
+    auto y = a * 2.0 + b;
+    auto s = sigmoid(y) / (pow(b, 2.0) - 1.0);
+    auto z = log(s);
+    EXPECT_EQ(GradNode::LiveNodeCount(), live_nodes + 3);
+    EXPECT_NEAR(z->GetData(), std::log((1 / (1 + std::exp(-7.0))) / 8.0),
+                1e-12);
+
+    z->Backward();
+    EXPECT_EQ(a->GetGrad(), 0.0);
+    EXPECT_EQ(b->GetGrad(), 0.0);
+  }
+  EXPECT_TRUE(GradNode::IsGradEnabled());
+  EXPECT_EQ(GradNode::LiveNodeCount(), live_nodes);
+}
+
+// Z = (2 - A / 4) * 3 + 6 / A - 1 + A^3
+TEST(Micrograd, ConstantOperands) {
+  auto a = GradNode::CreateGradnode(2.0, "a");
+  auto live_nodes = GradNode::LiveNodeCount();
+
+  auto z = (2.0 - a / 4.0) * 3.0 + 6.0 / a - 1.0 + pow(a, 3.0);
+  // Constants are stored in their operation's node instead of in a child.
+  EXPECT_EQ(GradNode::LiveNodeCount(), live_nodes + 8);
+  z->Backward();
+
+  EXPECT_EQ(z->GetData(), 14.5);
+  EXPECT_EQ(a->GetGrad(), -0.75 - 1.5 + 12.0);
+  EXPECT_EQ(z->GetLabel(),
+            "2.000000-a/4.000000*3.000000+6.000000/a-1.000000+a^3.000000");
+}
+
+TEST(Micrograd, Sum) {
+  auto a = GradNode::CreateGradnode(1.0, "a");
+  auto b = GradNode::CreateGradnode(2.0, "b");
+  auto c = GradNode::CreateGradnode(3.0, "c");
+
+  auto z = Sum({a, b, c, a});
+  z->Backward();
+
+  EXPECT_EQ(z->GetData(), 7.0);
+  EXPECT_EQ(a->GetGrad(), 2.0);
+  EXPECT_EQ(b->GetGrad(), 1.0);
+  EXPECT_EQ(c->GetGrad(), 1.0);
+  EXPECT_EQ(z->GetLabel(), "a+b+c+a");
+}
+
+// Z = Dot([A, B], [C, D]) + Dot([A, B], [2, 3]) + B^2
+TEST(Micrograd, Dot) {
+  auto a = GradNode::CreateGradnode(1.0, "a");
+  auto b = GradNode::CreateGradnode(2.0, "b");
+  auto c = GradNode::CreateGradnode(3.0, "c");
+  auto d = GradNode::CreateGradnode(4.0, "d");
+  auto live_nodes = GradNode::LiveNodeCount();
+
+  auto z = Dot({a, b}, {c, d}) + Dot({a, b}, {2.0, 3.0}) + pow(b, 2.0);
+  EXPECT_EQ(GradNode::LiveNodeCount(), live_nodes + 5);
+  z->Backward();
+
+  EXPECT_EQ(z->GetData(), 11.0 + 8.0 + 4.0);
+  EXPECT_EQ(a->GetGrad(), 3.0 + 2.0);
+  EXPECT_EQ(b->GetGrad(), 4.0 + 3.0 + 4.0);
+  EXPECT_EQ(c->GetGrad(), 1.0);
+  EXPECT_EQ(d->GetGrad(), 2.0);
+  EXPECT_THROW(Dot({a, b}, {c}), std::invalid_argument);
+  EXPECT_THROW(Dot({a}, {1.0, 2.0}), std::invalid_argument);
+}
+
+TEST(Micrograd, Label) {
+  auto a = GradNode::CreateGradnode(2.0, "a");
+  auto b = GradNode::CreateGradnode(3.0, "b");
+  auto c = a * b + 2.0;
+  auto z = log(c);
+
+  EXPECT_EQ(a->GetLabel(), "a");
+  EXPECT_EQ(z->GetLabel(), "log(a*b+2.000000)");
+}
+
+TEST(Micrograd, DeepLabelIsElided) {
+  auto a = GradNode::CreateGradnode(1.0, "a");
+  auto z = a;
+  for (int i = 0; i < 100000; i++) {
+    z = z + a;
+  }
+
+  EXPECT_EQ(z->GetLabel().rfind("...+a+a", 0), 0);
+}
+
+// Sums sigmoid(w * x_i) over many samples with a balanced tree of additions,
+// so the levels near the leaves are wide enough to run in parallel.
+TEST(Micrograd, ParallelBackward) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto b = GradNode::CreateGradnode(-1.0, "b");
+  auto build = [&]() {
+    std::vector<std::shared_ptr<GradNode>> terms;
+    for (int i = 0; i < 4096; i++) {
+      auto z = w * (i / 1024.0) + b;
+      terms.push_back(sigmoid(z) * z);
+    }
+    while (terms.size() > 1) {
+      std::vector<std::shared_ptr<GradNode>> sums;
+      for (size_t i = 0; i < terms.size(); i += 2) {
+        sums.push_back(terms[i] + terms[i + 1]);
+      }
+      terms = sums;
+    }
+    return terms[0];
+  };
+
+  auto serial = build();
+  serial->Backward();
+  auto w_grad = w->GetGrad();
+  auto b_grad = b->GetGrad();
+
+  ThreadPool pool(4);
+  auto parallel = build();
+  w->ZeroGrad();
+  b->ZeroGrad();
+  parallel->Backward(pool);
+
+  EXPECT_NEAR(w->GetGrad(), w_grad, 1e-9);
+  EXPECT_NEAR(b->GetGrad(), b_grad, 1e-9);
+  EXPECT_EQ(parallel->GetData(), serial->GetData());
+}
+
+// Custom nodes that add to a shared child through AccumulateGrad().
+TEST(Micrograd, ParallelBackwardCustomNodes) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto build = [&]() {
+    std::vector<std::shared_ptr<GradNode>> terms;
+    for (int i = 0; i < 4096; i++) {
+      auto scale = i / 4096.0;
+      // The sum passes a gradient of 1 to every term.
+      terms.push_back(GradNode::CreateGradnode(
+          w->GetData() * scale, "", {w},
+          [w = w.get(), scale]() { w->AccumulateGrad(scale); }));
+    }
+    return Sum(terms);
+  };
+
+  auto serial = build();
+  serial->Backward();
+  auto w_grad = w->GetGrad();
+
+  ThreadPool pool(4);
+  auto parallel = build();
+  w->ZeroGrad();
+  parallel->Backward(pool);
+
+  EXPECT_NEAR(w->GetGrad(), w_grad, 1e-9);
+  EXPECT_NEAR(w_grad, 4095 / 2.0, 1e-9);
+}
+
+TEST(Micrograd, FloatNodes) {
+  auto a = FloatGradNode::CreateGradnode(3.0f, "a");
+  auto b = FloatGradNode::CreateGradnode(-2.0f, "b");
+
+  // f = a^2 * b + tanh(b) / 2
+  auto a_squared = pow(a, 2.0f);
+  auto tanh_b = tanh(b);
+  auto f = a_squared * b + tanh_b / 2;
+  f->Backward();
+
+  static_assert(std::is_same<decltype(f->GetData()), float>::value,
+                "float nodes hold float values");
+  EXPECT_FLOAT_EQ(f->GetData(), -18.0f + std::tanh(-2.0f) / 2);
+  EXPECT_FLOAT_EQ(a->GetGrad(), 2 * 3.0f * -2.0f);
+  EXPECT_FLOAT_EQ(b->GetGrad(),
+                  9.0f + (1 - std::tanh(-2.0f) * std::tanh(-2.0f)) / 2);
+  EXPECT_LT(sizeof(FloatGradNode), sizeof(GradNode));
+}
+
+// Float values with double gradients: many small contributions accumulate
+// without the rounding of a float gradient.
+TEST(Micrograd, MixedPrecisionNodes) {
+  auto w = MixedGradNode::CreateGradnode(0.5f, "w");
+  std::vector<std::shared_ptr<MixedGradNode>> terms;
+  for (int i = 0; i < 1000; i++) {
+    terms.push_back(w * 0.001f);
+  }
+  auto loss = Sum(terms);
+  loss->Backward();
+
+  static_assert(std::is_same<decltype(w->GetData()), float>::value,
+                "mixed nodes hold float values");
+  static_assert(std::is_same<decltype(w->GetGrad()), double>::value,
+                "mixed nodes hold double gradients");
+  EXPECT_NEAR(w->GetGrad(), 1000 * static_cast<double>(0.001f), 1e-12);
+  EXPECT_NEAR(loss->GetData(), 0.5f, 1e-5f);
+}
+
+// Applies x -> tanh(0.9 x + 0.1) 1024 times, in 32 checkpointed segments.
+TEST(Micrograd, Checkpoint) {
+  auto step = [](std::shared_ptr<GradNode> x) {
+    auto z = 0.9 * x + 0.1;
+    return tanh(z);
+  };
+  auto w = GradNode::CreateGradnode(0.5, "w");
+
+  auto plain = w;
+  for (int i = 0; i < 1024; i++) {
+    plain = step(plain);
+  }
+  plain->Backward();
+  auto w_grad = w->GetGrad();
+  w->ZeroGrad();
+
+  auto live_nodes = GradNode::LiveNodeCount();
+  auto segment = [&](const std::vector<std::shared_ptr<GradNode>> &xs) {
+    auto x = xs[0];
+    for (int i = 0; i < 32; i++) {
+      x = step(x);
+    }
+    return x;
+  };
+  auto checkpointed = w;
+  for (int i = 0; i < 32; i++) {
+    checkpointed = Checkpoint(segment, {checkpointed});
+  }
+  EXPECT_EQ(GradNode::LiveNodeCount(), live_nodes + 32);
+
+  checkpointed->Backward();
+  EXPECT_EQ(checkpointed->GetData(), plain->GetData());
+  EXPECT_NEAR(w->GetGrad(), w_grad, 1e-12);
+  EXPECT_EQ(GradNode::LiveNodeCount(), live_nodes + 32);
+}
+
+// A parameter captured by the segment gets the gradient of the plain graph,
+// scaled by the gradient of the checkpoint.
+TEST(Micrograd, CheckpointCapturedParameter) {
+  auto w = GradNode::CreateGradnode(2.0, "w");
+  auto segment = [w](const std::vector<std::shared_ptr<GradNode>> &xs) {
+    auto z = xs[0] * w;
+    return tanh(z) * w;
+  };
+  auto build = [&](bool checkpoint) {
+    std::vector<std::shared_ptr<GradNode>> terms;
+    for (int i = 0; i < 1024; i++) {
+      auto x = GradNode::CreateGradnode(i / 1024.0, "");
+      auto term = checkpoint ? Checkpoint(segment, {x}) : segment({x});
+      terms.push_back(term * 3.0);
+    }
+    return Sum(terms);
+  };
+
+  auto plain = build(false);
+  plain->Backward();
+  auto w_grad = w->GetGrad();
+
+  w->ZeroGrad();
+  auto serial = build(true);
+  serial->Backward();
+  EXPECT_NEAR(w->GetGrad(), w_grad, 1e-9);
+
+  w->ZeroGrad();
+  ThreadPool pool(4);
+  auto parallel = build(true);
+  parallel->Backward(pool);
+  EXPECT_NEAR(w->GetGrad(), w_grad, 1e-9);
+
+  // A captured node computed from w cannot receive its gradient.
+  auto w_squared = w * w;
+  auto captured =
+      [w_squared](const std::vector<std::shared_ptr<GradNode>> &xs) {
+        return xs[0] * w_squared;
+      };
+  auto x = GradNode::CreateGradnode(1.0, "x");
+  EXPECT_THROW(Checkpoint(captured, {x}), std::invalid_argument);
+
+  // A segment that only captures it when recomputed fails before passing on
+  // any gradient.
+  auto calls = std::make_shared<int>(0);
+  auto late = [w_squared, calls](
+                  const std::vector<std::shared_ptr<GradNode>> &xs) {
+    return (*calls)++ == 0 ? xs[0] * 2.0 : xs[0] * w_squared;
+  };
+  auto out = Checkpoint(late, {x});
+  EXPECT_THROW(out->Backward(), std::invalid_argument);
+  EXPECT_EQ(x->GetGrad(), 0.0);
+}
+
+// Checkpoints may run on the workers of a parallel backward pass.
+TEST(Micrograd, CheckpointParallelBackward) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto segment = [](const std::vector<std::shared_ptr<GradNode>> &xs) {
+    auto z = xs[0] * xs[1];
+    return sigmoid(z) * z;
+  };
+  auto build = [&](bool checkpoint) {
+    std::vector<std::shared_ptr<GradNode>> terms;
+    for (int i = 0; i < 1024; i++) {
+      auto x = GradNode::CreateGradnode(i / 256.0, "");
+      terms.push_back(checkpoint ? Checkpoint(segment, {w, x})
+                                 : segment({w, x}));
+    }
+    return Sum(terms);
+  };
+
+  auto serial = build(false);
+  serial->Backward();
+  auto w_grad = w->GetGrad();
+
+  ThreadPool pool(4);
+  auto parallel = build(true);
+  w->ZeroGrad();
+  parallel->Backward(pool);
+
+  EXPECT_NEAR(w->GetGrad(), w_grad, 1e-9);
+  EXPECT_NEAR(parallel->GetData(), serial->GetData(), 1e-9);
+}
+
 } // namespace
 } // namespace micrograd
 } // namespace apexkid
@@ -0,0 +1,151 @@
+#include "nn.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+std::shared_ptr<GradNode> Activate(std::shared_ptr<GradNode> x,
+                                   Activation activation) {
+  switch (activation) {
+  case Activation::kLinear:
+    break;
+  case Activation::kRelu:
+    return relu(x);
+  case Activation::kTanh:
+    return tanh(x);
+  case Activation::kSigmoid:
+    return sigmoid(x);
+  }
+  return x;
+}
+
+Neuron::Neuron(size_t num_inputs, Activation activation, std::mt19937 *rng)
+    : activation_(activation) {
+  std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+  weights_.reserve(num_inputs);
+  for (size_t i = 0; i < num_inputs; i++) {
+    weights_.push_back(GradNode::CreateGradnode(distribution(*rng), ""));
+  }
+  bias_ = GradNode::CreateGradnode(0.0, "");
+}
+
+std::shared_ptr<GradNode>
+Neuron::Forward(const std::vector<std::shared_ptr<GradNode>> &x) const {
+  return Activate(Dot(weights_, x) + bias_, activation_);
+}
+
+std::shared_ptr<GradNode>
+Neuron::Forward(const std::vector<double> &x) const {
+  return Activate(Dot(weights_, x) + bias_, activation_);
+}
+
+std::vector<std::shared_ptr<GradNode>> Neuron::Parameters() const {
+  auto parameters = weights_;
+  parameters.push_back(bias_);
+  return parameters;
+}
+
+Layer::Layer(size_t num_inputs, size_t num_outputs, Activation activation,
+             std::mt19937 *rng) {
+  neurons_.reserve(num_outputs);
+  for (size_t i = 0; i < num_outputs; i++) {
+    neurons_.emplace_back(num_inputs, activation, rng);
+  }
+}
+
+std::vector<std::shared_ptr<GradNode>>
+Layer::Forward(const std::vector<std::shared_ptr<GradNode>> &x) const {
+  std::vector<std::shared_ptr<GradNode>> outputs;
+  outputs.reserve(neurons_.size());
+  for (auto &neuron : neurons_) {
+    outputs.push_back(neuron.Forward(x));
+  }
+  return outputs;
+}
+
+std::vector<std::shared_ptr<GradNode>>
+Layer::Forward(const std::vector<double> &x) const {
+  std::vector<std::shared_ptr<GradNode>> outputs;
+  outputs.reserve(neurons_.size());
+  for (auto &neuron : neurons_) {
+    outputs.push_back(neuron.Forward(x));
+  }
+  return outputs;
+}
+
+std::vector<std::shared_ptr<GradNode>> Layer::Parameters() const {
+  std::vector<std::shared_ptr<GradNode>> parameters;
+  for (auto &neuron : neurons_) {
+    auto neuron_parameters = neuron.Parameters();
+    parameters.insert(parameters.end(), neuron_parameters.begin(),
+                      neuron_parameters.end());
+  }
+  return parameters;
+}
+
+MLP::MLP(size_t num_inputs, const std::vector<size_t> &layer_sizes,
+         Activation hidden_activation, Activation output_activation,
+         uint32_t seed) {
+  std::mt19937 rng(seed);
+  layers_.reserve(layer_sizes.size());
+  for (size_t i = 0; i < layer_sizes.size(); i++) {
+    auto activation = i + 1 == layer_sizes.size() ? output_activation
+                                                  : hidden_activation;
+    layers_.emplace_back(num_inputs, layer_sizes[i], activation, &rng);
+    num_inputs = layer_sizes[i];
+  }
+}
+
+std::vector<std::shared_ptr<GradNode>>
+MLP::Forward(const std::vector<std::shared_ptr<GradNode>> &x) const {
+  auto outputs = x;
+  for (auto &layer : layers_) {
+    outputs = layer.Forward(outputs);
+  }
+  return outputs;
+}
+
+std::vector<std::shared_ptr<GradNode>>
+MLP::Forward(const std::vector<double> &x) const {
+  if (layers_.empty()) {
+    std::vector<std::shared_ptr<GradNode>> outputs;
+    for (auto value : x) {
+      outputs.push_back(GradNode::CreateGradnode(value, ""));
+    }
+    return outputs;
+  }
+  // The first layer reads the inputs as constants, so they need no nodes.
+  auto outputs = layers_[0].Forward(x);
+  for (size_t i = 1; i < layers_.size(); i++) {
+    outputs = layers_[i].Forward(outputs);
+  }
+  return outputs;
+}
+
+std::vector<std::vector<std::shared_ptr<GradNode>>>
+MLP::ForwardBatch(const std::vector<std::vector<double>> &batch) const {
+  std::vector<std::vector<std::shared_ptr<GradNode>>> outputs;
+  outputs.reserve(batch.size());
+  for (auto &x : batch) {
+    outputs.push_back(Forward(x));
+  }
+  return outputs;
+}
+
+std::vector<std::shared_ptr<GradNode>> MLP::Parameters() const {
+  std::vector<std::shared_ptr<GradNode>> parameters;
+  for (auto &layer : layers_) {
+    auto layer_parameters = layer.Parameters();
+    parameters.insert(parameters.end(), layer_parameters.begin(),
+                      layer_parameters.end());
+  }
+  return parameters;
+}
+
+} // namespace micrograd
+} // namespace apexkid
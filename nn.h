@@ -0,0 +1,184 @@
+#ifndef NN_H
+#define NN_H
+
+#include "micrograd.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+/// The nonlinearity applied to the output of a neuron.
+enum class Activation : uint8_t {
+  kLinear,
+  kRelu,
+  kTanh,
+  kSigmoid,
+};
+
+/**
+ * @brief Applies an activation to a node.
+ * @param x The node.
+ * @param activation The activation.
+ * @return The activated node, or x itself for Activation::kLinear.
+ */
+std::shared_ptr<GradNode> Activate(std::shared_ptr<GradNode> x,
+                                   Activation activation);
+
+/**
+ * @class Neuron
+ * @brief A weighted sum of its inputs plus a bias, followed by an activation.
+ *
+ * The weights and bias are leaf nodes created once and shared by every graph
+ * the neuron is evaluated in. The weighted sum is a single Dot node.
+ */
+class Neuron {
+public:
+  /**
+   * @brief Constructs a neuron with weights drawn uniformly from [-1, 1] and a
+   * zero bias.
+   * @param num_inputs The number of inputs.
+   * @param activation The activation applied to the output.
+   * @param rng The source of the initial weights.
+   */
+  Neuron(size_t num_inputs, Activation activation, std::mt19937 *rng);
+
+  /**
+   * @brief Evaluates the neuron on nodes.
+   * @param x The inputs, one per weight.
+   * @return The output node.
+   */
+  std::shared_ptr<GradNode>
+  Forward(const std::vector<std::shared_ptr<GradNode>> &x) const;
+
+  /**
+   * @brief Evaluates the neuron on constant inputs.
+   * @param x The inputs, one per weight.
+   * @return The output node.
+   */
+  std::shared_ptr<GradNode> Forward(const std::vector<double> &x) const;
+
+  /**
+   * @brief Gets the parameters of the neuron.
+   * @return The weights followed by the bias.
+   */
+  std::vector<std::shared_ptr<GradNode>> Parameters() const;
+
+private:
+  std::vector<std::shared_ptr<GradNode>> weights_; // One weight per input.
+  std::shared_ptr<GradNode> bias_;                 // The bias.
+  Activation activation_;                          // The output activation.
+};
+
+/**
+ * @class Layer
+ * @brief A set of neurons evaluated on the same inputs.
+ */
+class Layer {
+public:
+  /**
+   * @brief Constructs a layer of freshly initialized neurons.
+   * @param num_inputs The number of inputs of every neuron.
+   * @param num_outputs The number of neurons.
+   * @param activation The activation of every neuron.
+   * @param rng The source of the initial weights.
+   */
+  Layer(size_t num_inputs, size_t num_outputs, Activation activation,
+        std::mt19937 *rng);
+
+  /**
+   * @brief Evaluates the layer on nodes.
+   * @param x The inputs.
+   * @return The output of every neuron.
+   */
+  std::vector<std::shared_ptr<GradNode>>
+  Forward(const std::vector<std::shared_ptr<GradNode>> &x) const;
+
+  /**
+   * @brief Evaluates the layer on constant inputs.
+   * @param x The inputs.
+   * @return The output of every neuron.
+   */
+  std::vector<std::shared_ptr<GradNode>>
+  Forward(const std::vector<double> &x) const;
+
+  /**
+   * @brief Gets the parameters of the layer.
+   * @return The parameters of every neuron, in order.
+   */
+  std::vector<std::shared_ptr<GradNode>> Parameters() const;
+
+private:
+  std::vector<Neuron> neurons_; // The neurons of the layer.
+};
+
+/**
+ * @class MLP
+ * @brief A multilayer perceptron: a sequence of fully connected layers.
+ *
+ * Every hidden layer uses the same activation; the output layer has its own,
+ * typically Activation::kLinear for regression or kSigmoid for
+ * classification.
+ */
+class MLP {
+public:
+  /**
+   * @brief Constructs a network with deterministic initial weights.
+   * @param num_inputs The number of inputs.
+   * @param layer_sizes The number of neurons of every layer, the last being
+   * the output layer.
+   * @param hidden_activation The activation of the hidden layers.
+   * @param output_activation The activation of the output layer.
+   * @param seed The seed of the initial weights.
+   */
+  MLP(size_t num_inputs, const std::vector<size_t> &layer_sizes,
+      Activation hidden_activation, Activation output_activation,
+      uint32_t seed = 0);
+
+  /**
+   * @brief Evaluates the network on nodes.
+   * @param x The inputs.
+   * @return The outputs of the last layer.
+   */
+  std::vector<std::shared_ptr<GradNode>>
+  Forward(const std::vector<std::shared_ptr<GradNode>> &x) const;
+
+  /**
+   * @brief Evaluates the network on constant inputs.
+   * @param x The inputs.
+   * @return The outputs of the last layer.
+   */
+  std::vector<std::shared_ptr<GradNode>>
+  Forward(const std::vector<double> &x) const;
+
+  /**
+   * @brief Evaluates the network on a batch of samples.
+   *
+   * Every sample gets its own graph, built on the same parameter nodes, so a
+   * loss summed over the batch accumulates all of their gradients.
+   * @param batch The inputs of every sample.
+   * @return The outputs of the last layer for every sample.
+   */
+  std::vector<std::vector<std::shared_ptr<GradNode>>>
+  ForwardBatch(const std::vector<std::vector<double>> &batch) const;
+
+  /**
+   * @brief Gets the parameters of the network.
+   *
+   * Pass them to ParameterSet::Add() to train the network with an optimizer.
+   * @return The parameters of every layer, in order.
+   */
+  std::vector<std::shared_ptr<GradNode>> Parameters() const;
+
+private:
+  std::vector<Layer> layers_; // The layers, input first.
+};
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // NN_H
@@ -0,0 +1,83 @@
+#include "micrograd.h"
+#include "nn.h"
+#include "parameter.h"
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+using namespace apexkid::micrograd;
+
+// Measures the training throughput of MLPs of several widths and depths, in
+// samples per second, for the forward pass alone and for forward plus
+// backward.
+//
+// Usage: bazel run -c opt //:nn_benchmark
+
+namespace {
+
+constexpr size_t kBatchSize = 64;
+constexpr double kMinSeconds = 0.2;
+
+// Runs one step over a batch until kMinSeconds have passed, and returns the
+// number of samples processed per second.
+double SamplesPerSecond(const MLP &mlp, ParameterSet *params,
+                        const std::vector<std::vector<double>> &batch,
+                        bool backward) {
+  using Clock = std::chrono::steady_clock;
+  size_t samples = 0;
+  auto start = Clock::now();
+  std::chrono::duration<double> elapsed(0);
+  while (elapsed.count() < kMinSeconds) {
+    auto outputs = mlp.ForwardBatch(batch);
+    std::vector<std::shared_ptr<GradNode>> predictions;
+    predictions.reserve(outputs.size());
+    for (auto &output : outputs) {
+      predictions.push_back(output[0]);
+    }
+    auto loss = Sum(predictions);
+    if (backward) {
+      params->ZeroGrad();
+      loss->Backward();
+    }
+    samples += batch.size();
+    elapsed = Clock::now() - start;
+  }
+  return samples / elapsed.count();
+}
+
+} // namespace
+
+int main() {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+
+  std::cout << "width depth forward_samples_per_sec "
+               "forward_backward_samples_per_sec"
+            << std::endl;
+  for (size_t width : {8, 32, 128}) {
+    for (size_t depth : {1, 2, 4}) {
+      std::vector<size_t> layer_sizes(depth, width);
+      layer_sizes.push_back(1);
+      MLP mlp(width, layer_sizes, Activation::kTanh, Activation::kLinear);
+      ParameterSet params;
+      for (auto &parameter : mlp.Parameters()) {
+        params.Add(parameter);
+      }
+
+      std::vector<std::vector<double>> batch(kBatchSize);
+      for (auto &x : batch) {
+        for (size_t i = 0; i < width; i++) {
+          x.push_back(distribution(rng));
+        }
+      }
+
+      auto forward = SamplesPerSecond(mlp, &params, batch, false);
+      auto forward_backward = SamplesPerSecond(mlp, &params, batch, true);
+      std::cout << width << " " << depth << " " << forward << " "
+                << forward_backward << std::endl;
+    }
+  }
+  return 0;
+}
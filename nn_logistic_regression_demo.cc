@@ -1,4 +1,7 @@
 #include "micrograd.h"
+#include "optimizer.h"
+#include "parameter.h"
+#include "static_graph.h"
 #include <iostream>
 #include <vector>
 using namespace apexkid::micrograd;
@@ -18,37 +21,49 @@ int main() {
                            1, 0, 1, 1, 0}; // Expensive (1) or cheap (0)
 
   // Initialize weights randomly between -1 and 1.
-  auto w1 = GradNode::CreateGradnode(0.1, "w1");
-  auto w2 = GradNode::CreateGradnode(0.7, "w2");
-  auto w3 = GradNode::CreateGradnode(-0.4, "w3");
-  auto b = GradNode::CreateGradnode(0.0, "b");
+  ParameterSet params;
+  auto w1 = params.Create(0.1, "w1");
+  auto w2 = params.Create(0.7, "w2");
+  auto w3 = params.Create(-0.4, "w3");
+  auto b = params.Create(0.0, "b");
 
   // Learning rate
   double lr = 0.001;
+  Sgd optimizer(&params, lr);
+
+  // Build the loss graph once, with placeholders for one training example.
+  auto x1_in = GradNode::CreateGradnode(0.0, "x1");
+  auto x2_in = GradNode::CreateGradnode(0.0, "x2");
+  auto x3_in = GradNode::CreateGradnode(0.0, "x3");
+  auto y_in = GradNode::CreateGradnode(0.0, "y");
+  auto z = Dot({w1, w2, w3}, {x1_in, x2_in, x3_in}) + b;
+  auto pred = sigmoid(z);
+  auto one_minus_pred = 1 - pred;
+  // Cross-entropy loss
+  auto loss = (0.0 - y_in) * log(pred) - (1.0 - y_in) * log(one_minus_pred);
+  StaticGraph graph(loss, {x1_in, x2_in, x3_in, y_in});
+
+  std::vector<std::vector<double>> samples;
+  for (size_t i = 0; i < x1.size(); i++) {
+    samples.push_back({x1[i], x2[i], x3[i], y[i]});
+  }
 
   // Training loop
   for (int epoch = 0; epoch < 10000; epoch++) {
-    std::shared_ptr<GradNode> loss;
     double cumulative_loss = 0;
-    for (int i = 0; i < x1.size(); i++) {
+    for (size_t i = 0; i < samples.size(); i++) {
+      optimizer.ZeroGrad();
+
       // Forward pass
-      auto z = w1 * x1[i] + w2 * x2[i] + w3 * x3[i] + b;
-      auto pred = sigmoid(z);
-      auto one_minus_pred = 1 - pred;
-      // Cross-entropy loss
-      loss = -y[i] * log(pred) - (1 - y[i]) * log(one_minus_pred);
-      cumulative_loss += loss->GetData();
+      cumulative_loss += graph.Forward(samples[i]);
 
       // Backward pass
       // This is an example of Stochastic Gradient Descent (SGD) as it is
       // running on each training example.
-      loss->Backward();
+      graph.Backward();
 
-      // Update weights
-      w1 = GradNode::CreateGradnode(w1->GetData() - lr * w1->GetGrad(), "w1");
-      w2 = GradNode::CreateGradnode(w2->GetData() - lr * w2->GetGrad(), "w2");
-      w3 = GradNode::CreateGradnode(w3->GetData() - lr * w3->GetGrad(), "w3");
-      b = GradNode::CreateGradnode(b->GetData() - lr * b->GetGrad(), "b");
+      // Update weights in place
+      optimizer.Step();
     }
     if (epoch % 100 == 0) {
       std::cout << "Epoch: " << epoch << " Loss: " << cumulative_loss
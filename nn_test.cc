@@ -0,0 +1,95 @@
+#include "nn.h"
+#include "optimizer.h"
+#include "parameter.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+TEST(NnTest, Parameters) {
+  MLP mlp(3, {4, 4, 1}, Activation::kTanh, Activation::kLinear);
+
+  // Every neuron has one weight per input and a bias.
+  EXPECT_EQ(mlp.Parameters().size(), 4 * 4 + 4 * 5 + 1 * 5);
+  for (auto &parameter : mlp.Parameters()) {
+    EXPECT_GE(parameter->GetData(), -1.0);
+    EXPECT_LE(parameter->GetData(), 1.0);
+  }
+}
+
+TEST(NnTest, NeuronActivations) {
+  std::mt19937 rng(0);
+  for (auto activation : {Activation::kLinear, Activation::kRelu,
+                          Activation::kTanh, Activation::kSigmoid}) {
+    Neuron neuron(2, activation, &rng);
+    auto parameters = neuron.Parameters();
+    parameters[0]->SetData(0.5);
+    parameters[1]->SetData(-2.0);
+    parameters[2]->SetData(0.25);
+
+    auto z = 0.5 * 1.0 - 2.0 * 1.5 + 0.25;
+    auto expected = z;
+    if (activation == Activation::kRelu) {
+      expected = 0.0;
+    } else if (activation == Activation::kTanh) {
+      expected = std::tanh(z);
+    } else if (activation == Activation::kSigmoid) {
+      expected = 1.0 / (1.0 + std::exp(-z));
+    }
+    EXPECT_NEAR(neuron.Forward({1.0, 1.5})->GetData(), expected, 1e-12);
+  }
+}
+
+TEST(NnTest, ForwardOnNodesMatchesConstants) {
+  MLP mlp(2, {3, 2}, Activation::kRelu, Activation::kSigmoid, 7);
+  auto x1 = GradNode::CreateGradnode(0.3, "x1");
+  auto x2 = GradNode::CreateGradnode(-0.8, "x2");
+
+  auto from_nodes = mlp.Forward({x1, x2});
+  auto from_constants = mlp.Forward({0.3, -0.8});
+  auto batch = mlp.ForwardBatch({{1.0, 1.0}, {0.3, -0.8}});
+
+  ASSERT_EQ(from_nodes.size(), 2);
+  ASSERT_EQ(batch.size(), 2);
+  for (size_t i = 0; i < 2; i++) {
+    EXPECT_EQ(from_nodes[i]->GetData(), from_constants[i]->GetData());
+    EXPECT_EQ(batch[1][i]->GetData(), from_constants[i]->GetData());
+  }
+}
+
+TEST(NnTest, LearnsXor) {
+  MLP mlp(2, {8, 1}, Activation::kTanh, Activation::kSigmoid, 1);
+  ParameterSet params;
+  for (auto &parameter : mlp.Parameters()) {
+    params.Add(parameter);
+  }
+  Adam optimizer(&params, 0.05);
+  std::vector<std::vector<double>> x = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+  std::vector<double> y = {0, 1, 1, 0};
+
+  double total_loss = 0.0;
+  for (int step = 0; step < 500; step++) {
+    optimizer.ZeroGrad();
+    std::vector<std::shared_ptr<GradNode>> losses;
+    auto outputs = mlp.ForwardBatch(x);
+    for (size_t i = 0; i < x.size(); i++) {
+      auto diff = outputs[i][0] - y[i];
+      losses.push_back(pow(diff, 2.0));
+    }
+    auto loss = Sum(losses);
+    loss->Backward();
+    optimizer.Step();
+    total_loss = loss->GetData();
+  }
+
+  EXPECT_LT(total_loss, 0.01);
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
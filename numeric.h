@@ -0,0 +1,27 @@
+#ifndef NUMERIC_H
+#define NUMERIC_H
+
+#include <cmath>
+
+namespace apexkid {
+namespace micrograd {
+namespace internal {
+
+/**
+ * @brief Computes the logistic sigmoid 1 / (1 + exp(-x)).
+ *
+ * Evaluates through exp(-|x|), which is at most 1, so that neither branch
+ * overflows for inputs of large magnitude.
+ * @param x The input.
+ * @return The sigmoid of x.
+ */
+template <typename T> inline T StableSigmoid(T x) {
+  T z = std::exp(-std::abs(x));
+  return x >= 0 ? T(1) / (T(1) + z) : z / (T(1) + z);
+}
+
+} // namespace internal
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // NUMERIC_H
@@ -0,0 +1,79 @@
+#include "optimizer.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+Optimizer::Optimizer(ParameterSet *params) : params_(params) {}
+
+void Optimizer::Step() {
+  params_->GatherData(&data_);
+  params_->GatherGrad(&grad_);
+  Update(data_.data(), grad_.data(), data_.size());
+  params_->ScatterData(data_);
+}
+
+void Optimizer::ZeroGrad() { params_->ZeroGrad(); }
+
+Sgd::Sgd(ParameterSet *params, double learning_rate, double momentum)
+    : Optimizer(params), learning_rate_(learning_rate), momentum_(momentum) {}
+
+void Sgd::Update(double *data, const double *grad, size_t size) {
+  if (momentum_ == 0.0) {
+    for (size_t i = 0; i < size; i++) {
+      data[i] -= learning_rate_ * grad[i];
+    }
+    return;
+  }
+  velocity_.resize(size, 0.0);
+  auto *velocity = velocity_.data();
+  for (size_t i = 0; i < size; i++) {
+    velocity[i] = momentum_ * velocity[i] + grad[i];
+    data[i] -= learning_rate_ * velocity[i];
+  }
+}
+
+Adam::Adam(ParameterSet *params, double learning_rate, double beta1,
+           double beta2, double epsilon)
+    : Optimizer(params), learning_rate_(learning_rate), beta1_(beta1),
+      beta2_(beta2), epsilon_(epsilon) {}
+
+void Adam::Update(double *data, const double *grad, size_t size) {
+  mean_.resize(size, 0.0);
+  var_.resize(size, 0.0);
+  step_++;
+  // Fold the bias corrections into the step size and epsilon so that the
+  // loop body is a handful of multiply-adds and one square root.
+  auto mean_correction = 1.0 - std::pow(beta1_, step_);
+  auto var_correction = std::sqrt(1.0 - std::pow(beta2_, step_));
+  auto step_size = learning_rate_ * var_correction / mean_correction;
+  auto epsilon = epsilon_ * var_correction;
+
+  auto *mean = mean_.data();
+  auto *var = var_.data();
+  for (size_t i = 0; i < size; i++) {
+    mean[i] = beta1_ * mean[i] + (1.0 - beta1_) * grad[i];
+    var[i] = beta2_ * var[i] + (1.0 - beta2_) * grad[i] * grad[i];
+    data[i] -= step_size * mean[i] / (std::sqrt(var[i]) + epsilon);
+  }
+}
+
+RmsProp::RmsProp(ParameterSet *params, double learning_rate, double decay,
+                 double epsilon)
+    : Optimizer(params), learning_rate_(learning_rate), decay_(decay),
+      epsilon_(epsilon) {}
+
+void RmsProp::Update(double *data, const double *grad, size_t size) {
+  square_avg_.resize(size, 0.0);
+  auto *square_avg = square_avg_.data();
+  for (size_t i = 0; i < size; i++) {
+    square_avg[i] = decay_ * square_avg[i] + (1.0 - decay_) * grad[i] * grad[i];
+    data[i] -= learning_rate_ * grad[i] / (std::sqrt(square_avg[i]) + epsilon_);
+  }
+}
+
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,140 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "parameter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+/**
+ * @class Optimizer
+ * @brief Base class for gradient-based parameter update rules.
+ *
+ * Step() copies the values and gradients of a ParameterSet into flat
+ * buffers, applies the update rule to the whole buffer in one loop and writes
+ * the values back. Update rules keep their state in buffers of the same
+ * layout. The copies are needed because the parameters live in their nodes;
+ * see ParameterSet.
+ */
+class Optimizer {
+public:
+  /**
+   * @brief Constructs an optimizer over a set of parameters.
+   * @param params The parameters to update. Must outlive the optimizer.
+   */
+  explicit Optimizer(ParameterSet *params);
+
+  virtual ~Optimizer() = default;
+
+  /**
+   * @brief Updates every parameter from its current gradient.
+   */
+  void Step();
+
+  /**
+   * @brief Resets the gradient of every parameter to zero.
+   */
+  void ZeroGrad();
+
+protected:
+  /**
+   * @brief Applies the update rule.
+   * @param data The parameter values, updated in place.
+   * @param grad The parameter gradients.
+   * @param size The number of parameters.
+   */
+  virtual void Update(double *data, const double *grad, size_t size) = 0;
+
+private:
+  ParameterSet *params_;     // The parameters to update.
+  std::vector<double> data_; // Flat copy of the parameter values.
+  std::vector<double> grad_; // Flat copy of the parameter gradients.
+};
+
+/**
+ * @class Sgd
+ * @brief Stochastic gradient descent with optional momentum.
+ */
+class Sgd : public Optimizer {
+public:
+  /**
+   * @brief Constructs an SGD optimizer.
+   * @param params The parameters to update.
+   * @param learning_rate The step size.
+   * @param momentum The velocity decay factor, or zero for plain SGD.
+   */
+  Sgd(ParameterSet *params, double learning_rate, double momentum = 0.0);
+
+protected:
+  void Update(double *data, const double *grad, size_t size) override;
+
+private:
+  double learning_rate_;
+  double momentum_;
+  std::vector<double> velocity_; // Running update direction per parameter.
+};
+
+/**
+ * @class Adam
+ * @brief Adam: SGD with bias-corrected first and second moment estimates.
+ */
+class Adam : public Optimizer {
+public:
+  /**
+   * @brief Constructs an Adam optimizer.
+   * @param params The parameters to update.
+   * @param learning_rate The step size.
+   * @param beta1 The decay rate of the first moment estimate.
+   * @param beta2 The decay rate of the second moment estimate.
+   * @param epsilon Added to the denominator for numerical stability.
+   */
+  Adam(ParameterSet *params, double learning_rate, double beta1 = 0.9,
+       double beta2 = 0.999, double epsilon = 1e-8);
+
+protected:
+  void Update(double *data, const double *grad, size_t size) override;
+
+private:
+  double learning_rate_;
+  double beta1_;
+  double beta2_;
+  double epsilon_;
+  int64_t step_ = 0;          // Number of updates applied so far.
+  std::vector<double> mean_;  // First moment estimate per parameter.
+  std::vector<double> var_;   // Second moment estimate per parameter.
+};
+
+/**
+ * @class RmsProp
+ * @brief RMSProp: SGD scaled by a running average of squared gradients.
+ */
+class RmsProp : public Optimizer {
+public:
+  /**
+   * @brief Constructs an RMSProp optimizer.
+   * @param params The parameters to update.
+   * @param learning_rate The step size.
+   * @param decay The decay rate of the squared gradient average.
+   * @param epsilon Added to the denominator for numerical stability.
+   */
+  RmsProp(ParameterSet *params, double learning_rate, double decay = 0.99,
+          double epsilon = 1e-8);
+
+protected:
+  void Update(double *data, const double *grad, size_t size) override;
+
+private:
+  double learning_rate_;
+  double decay_;
+  double epsilon_;
+  std::vector<double> square_avg_; // Squared gradient average per parameter.
+};
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // OPTIMIZER_H
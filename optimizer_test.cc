@@ -0,0 +1,84 @@
+#include "optimizer.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+// Accumulates the gradient of (w - target)^2 into w.
+void Backward(std::shared_ptr<GradNode> &w, double target) {
+  auto diff = w - target;
+  auto loss = pow(diff, 2.0);
+  loss->Backward();
+}
+
+TEST(OptimizerTest, Sgd) {
+  ParameterSet params;
+  auto w = params.Create(2.0, "w");
+  Sgd optimizer(&params, 0.1);
+
+  Backward(w, 0.0);
+  optimizer.Step();
+
+  EXPECT_DOUBLE_EQ(w->GetData(), 1.6);
+}
+
+TEST(OptimizerTest, SgdMomentum) {
+  ParameterSet params;
+  auto w = params.Create(2.0, "w");
+  Sgd optimizer(&params, 0.1, 0.9);
+
+  Backward(w, 0.0);
+  optimizer.Step();
+  EXPECT_DOUBLE_EQ(w->GetData(), 1.6);
+
+  optimizer.ZeroGrad();
+  Backward(w, 0.0);
+  optimizer.Step();
+  EXPECT_DOUBLE_EQ(w->GetData(), 1.6 - 0.1 * (0.9 * 4.0 + 3.2));
+}
+
+TEST(OptimizerTest, AdamFirstStepIsLearningRate) {
+  ParameterSet params;
+  auto w = params.Create(2.0, "w");
+  auto v = params.Create(-1.0, "v");
+  Adam optimizer(&params, 0.01);
+
+  Backward(w, 0.0);
+  Backward(v, 0.0);
+  optimizer.Step();
+
+  EXPECT_NEAR(w->GetData(), 1.99, 1e-9);
+  EXPECT_NEAR(v->GetData(), -0.99, 1e-9);
+}
+
+TEST(OptimizerTest, RmsPropFirstStep) {
+  ParameterSet params;
+  auto w = params.Create(2.0, "w");
+  RmsProp optimizer(&params, 0.01);
+
+  Backward(w, 0.0);
+  optimizer.Step();
+
+  EXPECT_NEAR(w->GetData(), 2.0 - 0.01 / std::sqrt(0.01), 1e-8);
+}
+
+TEST(OptimizerTest, AdamConverges) {
+  ParameterSet params;
+  auto w = params.Create(-5.0, "w");
+  Adam optimizer(&params, 0.1);
+
+  for (int step = 0; step < 1000; step++) {
+    optimizer.ZeroGrad();
+    Backward(w, 3.0);
+    optimizer.Step();
+  }
+
+  EXPECT_NEAR(w->GetData(), 3.0, 1e-3);
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,58 @@
+#include "parameter.h"
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+std::shared_ptr<GradNode> ParameterSet::Create(double data,
+                                               std::string label) {
+  auto parameter = GradNode::CreateGradnode(data, std::move(label));
+  parameters_.push_back(parameter);
+  return parameter;
+}
+
+void ParameterSet::Add(std::shared_ptr<GradNode> parameter) {
+  parameters_.push_back(std::move(parameter));
+}
+
+void ParameterSet::ZeroGrad() {
+  for (auto &parameter : parameters_) {
+    parameter->ZeroGrad();
+  }
+}
+
+void ParameterSet::GatherData(std::vector<double> *data) const {
+  data->resize(parameters_.size());
+  for (size_t i = 0; i < parameters_.size(); i++) {
+    (*data)[i] = parameters_[i]->GetData();
+  }
+}
+
+void ParameterSet::GatherGrad(std::vector<double> *grad) const {
+  grad->resize(parameters_.size());
+  for (size_t i = 0; i < parameters_.size(); i++) {
+    (*grad)[i] = parameters_[i]->GetGrad();
+  }
+}
+
+void ParameterSet::AccumulateGrad(const std::vector<double> &grad) {
+  assert(grad.size() == parameters_.size());
+  for (size_t i = 0; i < parameters_.size(); i++) {
+    parameters_[i]->AccumulateGrad(grad[i]);
+  }
+}
+
+void ParameterSet::ScatterData(const std::vector<double> &data) {
+  assert(data.size() == parameters_.size());
+  for (size_t i = 0; i < parameters_.size(); i++) {
+    parameters_[i]->SetData(data[i]);
+  }
+}
+
+} // namespace micrograd
+} // namespace apexkid
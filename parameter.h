@@ -0,0 +1,99 @@
+#ifndef PARAMETER_H
+#define PARAMETER_H
+
+#include "micrograd.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+/**
+ * @class ParameterSet
+ * @brief A collection of persistent leaf nodes, such as model weights.
+ *
+ * Parameters live across training steps: each step builds a new graph on top
+ * of the same parameter nodes, and the set resets and updates them in place
+ * instead of recreating them. Optimizers work on flat copies of the values
+ * and gradients obtained through GatherData/GatherGrad/ScatterData.
+ *
+ * The values and gradients stay in the nodes, which hold them as plain
+ * members, rather than in storage owned by the set: backing them with one
+ * buffer would add an indirection to every operator. The cost is that each
+ * optimizer step copies through the node pointers three times, gathering the
+ * values and gradients and scattering the values back, which is O(Size())
+ * and small next to the backward pass that produced the gradients.
+ */
+class ParameterSet {
+public:
+  ParameterSet() = default;
+
+  /**
+   * @brief Creates a parameter and adds it to the set.
+   * @param data The initial value of the parameter.
+   * @param label A label to identify the parameter.
+   * @return A shared pointer to the created parameter.
+   */
+  std::shared_ptr<GradNode> Create(double data, std::string label);
+
+  /**
+   * @brief Adds an existing leaf node to the set.
+   * @param parameter The node to add.
+   */
+  void Add(std::shared_ptr<GradNode> parameter);
+
+  /**
+   * @brief Resets the gradient of every parameter to zero.
+   */
+  void ZeroGrad();
+
+  /**
+   * @brief Copies the value of every parameter into a flat buffer.
+   * @param data The buffer, resized to Size().
+   */
+  void GatherData(std::vector<double> *data) const;
+
+  /**
+   * @brief Copies the gradient of every parameter into a flat buffer.
+   * @param grad The buffer, resized to Size().
+   */
+  void GatherGrad(std::vector<double> *grad) const;
+
+  /**
+   * @brief Adds a flat buffer of gradients to the parameters' gradients.
+   * @param grad The buffer holding Size() gradients.
+   */
+  void AccumulateGrad(const std::vector<double> &grad);
+
+  /**
+   * @brief Sets the value of every parameter from a flat buffer.
+   * @param data The buffer holding Size() values.
+   */
+  void ScatterData(const std::vector<double> &data);
+
+  /**
+   * @brief Gets the number of parameters.
+   * @return The number of parameters.
+   */
+  size_t Size() const { return parameters_.size(); }
+
+  /**
+   * @brief Gets a parameter by position.
+   * @param index The position of the parameter in the set.
+   * @return A shared pointer to the parameter.
+   */
+  const std::shared_ptr<GradNode> &Get(size_t index) const {
+    return parameters_[index];
+  }
+
+private:
+  std::vector<std::shared_ptr<GradNode>> parameters_; // Parameter nodes.
+};
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // PARAMETER_H
@@ -0,0 +1,65 @@
+#include "parameter.h"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+TEST(ParameterSetTest, ZeroGrad) {
+  ParameterSet params;
+  auto w = params.Create(2.0, "w");
+  auto b = params.Create(1.0, "b");
+
+  auto z = w * 3.0 + b;
+  z->Backward();
+  EXPECT_EQ(w->GetGrad(), 3.0);
+  EXPECT_EQ(b->GetGrad(), 1.0);
+
+  params.ZeroGrad();
+  EXPECT_EQ(w->GetGrad(), 0.0);
+  EXPECT_EQ(b->GetGrad(), 0.0);
+}
+
+TEST(ParameterSetTest, GatherAndScatter) {
+  ParameterSet params;
+  auto w = params.Create(2.0, "w");
+  params.Add(GradNode::CreateGradnode(5.0, "b"));
+
+  auto z = w * w;
+  z->Backward();
+
+  std::vector<double> data;
+  std::vector<double> grad;
+  params.GatherData(&data);
+  params.GatherGrad(&grad);
+  EXPECT_EQ(data, (std::vector<double>{2.0, 5.0}));
+  EXPECT_EQ(grad, (std::vector<double>{4.0, 0.0}));
+
+  params.ScatterData({-1.0, 7.0});
+  EXPECT_EQ(w->GetData(), -1.0);
+  EXPECT_EQ(params.Get(1)->GetData(), 7.0);
+}
+
+// Parameters are reused across steps instead of being recreated.
+TEST(ParameterSetTest, TrainingStepsReuseParameters) {
+  ParameterSet params;
+  auto w = params.Create(0.0, "w");
+  auto live_nodes = GradNode::LiveNodeCount();
+
+  for (int step = 0; step < 100; step++) {
+    params.ZeroGrad();
+    auto diff = w * 2.0 - 4.0;
+    auto loss = pow(diff, 2.0);
+    loss->Backward();
+    w->SetData(w->GetData() - 0.05 * w->GetGrad());
+  }
+
+  EXPECT_NEAR(w->GetData(), 2.0, 1e-9);
+  EXPECT_EQ(GradNode::LiveNodeCount(), live_nodes);
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,229 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+namespace {
+
+// The innermost live profiler of this thread. See Profiler::Active.
+thread_local Profiler *active_profiler = nullptr;
+
+} // namespace
+
+const char *OpName(GradNode::Op op) {
+  switch (op) {
+  case GradNode::Op::kLeaf:
+    return "leaf";
+  case GradNode::Op::kCustom:
+    return "custom";
+  case GradNode::Op::kAdd:
+    return "add";
+  case GradNode::Op::kSub:
+    return "sub";
+  case GradNode::Op::kMul:
+    return "mul";
+  case GradNode::Op::kDiv:
+    return "div";
+  case GradNode::Op::kPow:
+    return "pow";
+  case GradNode::Op::kLog:
+    return "log";
+  case GradNode::Op::kSigmoid:
+    return "sigmoid";
+  case GradNode::Op::kTanh:
+    return "tanh";
+  case GradNode::Op::kRelu:
+    return "relu";
+  case GradNode::Op::kAddConstant:
+    return "add_constant";
+  case GradNode::Op::kSubConstant:
+    return "sub_constant";
+  case GradNode::Op::kRSubConstant:
+    return "rsub_constant";
+  case GradNode::Op::kMulConstant:
+    return "mul_constant";
+  case GradNode::Op::kDivConstant:
+    return "div_constant";
+  case GradNode::Op::kRDivConstant:
+    return "rdiv_constant";
+  case GradNode::Op::kPowConstant:
+    return "pow_constant";
+  case GradNode::Op::kSum:
+    return "sum";
+  case GradNode::Op::kDot:
+    return "dot";
+  case GradNode::Op::kDotConstant:
+    return "dot_constant";
+  }
+  return "unknown";
+}
+
+Profiler::Profiler() : previous_(active_profiler), origin_(Clock::now()) {
+  active_profiler = this;
+}
+
+Profiler::~Profiler() { active_profiler = previous_; }
+
+Profiler *Profiler::Active() { return active_profiler; }
+
+int64_t Profiler::Now() const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                              origin_)
+      .count();
+}
+
+void Profiler::Reset() {
+  stats_ = ProfileStats();
+  events_.clear();
+  construction_begin_ns_ = -1;
+  construction_end_ns_ = -1;
+  step_begin_ns_.clear();
+}
+
+void Profiler::BeginStep() {
+  FlushConstruction();
+  step_begin_ns_.push_back(Now());
+}
+
+void Profiler::EndStep() {
+  if (step_begin_ns_.empty()) {
+    return;
+  }
+  FlushConstruction();
+  events_.push_back({"step", step_begin_ns_.back(), Now()});
+  step_begin_ns_.pop_back();
+}
+
+void Profiler::BeginOp(GradNode::Op op) {
+  current_op_ = op;
+  op_begin_ns_ = Now();
+  if (construction_begin_ns_ < 0) {
+    construction_begin_ns_ = op_begin_ns_;
+  }
+}
+
+void Profiler::EndOp() {
+  current_op_ = GradNode::Op::kLeaf;
+  construction_end_ns_ = Now();
+  stats_.construction_ns += construction_end_ns_ - op_begin_ns_;
+}
+
+void Profiler::RecordNode(size_t live_nodes, size_t node_bytes) {
+  stats_.nodes_created[static_cast<size_t>(current_op_)]++;
+  if (live_nodes > stats_.peak_live_nodes) {
+    stats_.peak_live_nodes = live_nodes;
+    stats_.peak_node_object_bytes = live_nodes * node_bytes;
+  }
+}
+
+void Profiler::RecordCustomNode(size_t live_nodes, size_t node_bytes) {
+  auto op = current_op_;
+  current_op_ = GradNode::Op::kCustom;
+  RecordNode(live_nodes, node_bytes);
+  current_op_ = op;
+}
+
+void Profiler::BeginSort() {
+  FlushConstruction();
+  sort_begin_ns_ = Now();
+}
+
+void Profiler::EndSort() {
+  auto end = Now();
+  stats_.sort_ns += end - sort_begin_ns_;
+  events_.push_back({"sort", sort_begin_ns_, end});
+}
+
+void Profiler::BeginBackward() {
+  // Backward passes nested in another, as a custom backward function may
+  // run, are part of the outer one.
+  if (backward_depth_++ > 0) {
+    return;
+  }
+  FlushConstruction();
+  backward_begin_ns_ = Now();
+}
+
+void Profiler::EndBackward() {
+  if (--backward_depth_ > 0) {
+    return;
+  }
+  auto end = Now();
+  stats_.backward_ns += end - backward_begin_ns_;
+  events_.push_back({"backward", backward_begin_ns_, end});
+}
+
+void Profiler::FlushConstruction() {
+  if (construction_begin_ns_ < 0) {
+    return;
+  }
+  events_.push_back(
+      {"construction", construction_begin_ns_, construction_end_ns_});
+  construction_begin_ns_ = -1;
+  construction_end_ns_ = -1;
+}
+
+std::string Profiler::Report() const {
+  std::ostringstream report;
+  report << "Nodes created:" << std::endl;
+  for (size_t op = 0; op < GradNode::kNumOps; op++) {
+    if (stats_.nodes_created[op] > 0) {
+      report << "  " << std::left << std::setw(16)
+             << OpName(static_cast<GradNode::Op>(op))
+             << stats_.nodes_created[op] << std::endl;
+    }
+  }
+  report << "Construction: " << stats_.construction_ns / 1000 << " us"
+         << std::endl;
+  report << "Sort: " << stats_.sort_ns / 1000 << " us" << std::endl;
+  report << "Backward: " << stats_.backward_ns / 1000 << " us" << std::endl;
+  report << "Peak live nodes: " << stats_.peak_live_nodes << " ("
+         << stats_.peak_node_object_bytes << " bytes of node objects)"
+         << std::endl;
+  return report.str();
+}
+
+std::string Profiler::ChromeTraceJson() const {
+  // Include the construction still pending, without changing the profiler.
+  auto events = events_;
+  if (construction_begin_ns_ >= 0) {
+    events.push_back(
+        {"construction", construction_begin_ns_, construction_end_ns_});
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const Event &a, const Event &b) {
+                     return a.begin_ns < b.begin_ns;
+                   });
+
+  std::ostringstream json;
+  json << std::fixed << std::setprecision(3);
+  json << "{\"traceEvents\":[";
+  for (size_t i = 0; i < events.size(); i++) {
+    json << (i > 0 ? "," : "") << "\n{\"name\":\"" << events[i].name
+         << "\",\"cat\":\"micrograd\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+         << ",\"ts\":" << events[i].begin_ns / 1000.0
+         << ",\"dur\":" << (events[i].end_ns - events[i].begin_ns) / 1000.0
+         << "}";
+  }
+  json << "\n],\"displayTimeUnit\":\"ns\"}\n";
+  return json.str();
+}
+
+bool Profiler::WriteChromeTrace(const std::string &path) const {
+  std::ofstream file(path);
+  file << ChromeTraceJson();
+  return static_cast<bool>(file);
+}
+
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,157 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "micrograd.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+/**
+ * @brief Gets the name of an operation, as used in profiles and traces.
+ * @param op The operation.
+ * @return The name, such as "add" or "sigmoid".
+ */
+const char *OpName(GradNode::Op op);
+
+/// Counters collected by a Profiler.
+struct ProfileStats {
+  /// Nodes created, indexed by the GradNode::Op that produced them.
+  std::array<uint64_t, GradNode::kNumOps> nodes_created{};
+  uint64_t construction_ns = 0; // Time spent in operators building nodes.
+  uint64_t sort_ns = 0;         // Time spent sorting graphs.
+  uint64_t backward_ns = 0;     // Time spent running backward functions.
+  size_t peak_live_nodes = 0;   // Most GradNode objects alive at once.
+  // sizeof the node objects counted by peak_live_nodes. Not a heap total:
+  // children, closures, labels and control blocks are not included.
+  size_t peak_node_object_bytes = 0;
+};
+
+/**
+ * @class Profiler
+ * @brief Instruments GradNode graphs built and differentiated on the current
+ * thread while in scope.
+ *
+ * Like NoGradGuard, a profiler is active on the thread that created it until
+ * it is destroyed. It counts the nodes created per operation, times graph
+ * construction, topological sorts and backward functions, and tracks the peak
+ * number of live nodes. With no active profiler the instrumentation costs one
+ * thread-local load per operation.
+ *
+ * The profiler also records a timeline that ChromeTraceJson() exports in the
+ * Chrome trace event format, for chrome://tracing or Perfetto. Consecutive
+ * operators are merged into one "construction" event, and BeginStep() and
+ * EndStep() mark training steps.
+ */
+class Profiler {
+public:
+  Profiler();
+  ~Profiler();
+
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  /**
+   * @brief Gets the profiler active on the current thread.
+   * @return The innermost live profiler of this thread, or nullptr.
+   */
+  static Profiler *Active();
+
+  /**
+   * @brief Gets the counters collected so far.
+   * @return The counters.
+   */
+  const ProfileStats &Stats() const { return stats_; }
+
+  /**
+   * @brief Clears the counters and the timeline.
+   */
+  void Reset();
+
+  /**
+   * @brief Marks the start of a training step in the timeline.
+   */
+  void BeginStep();
+
+  /**
+   * @brief Marks the end of the training step begun last.
+   */
+  void EndStep();
+
+  /**
+   * @brief Formats the counters as a human-readable table.
+   * @return The report.
+   */
+  std::string Report() const;
+
+  /**
+   * @brief Exports the timeline in the Chrome trace event format.
+   * @return The JSON document.
+   */
+  std::string ChromeTraceJson() const;
+
+  /**
+   * @brief Writes ChromeTraceJson() to a file.
+   * @param path The file to write.
+   * @return True if the file was written.
+   */
+  bool WriteChromeTrace(const std::string &path) const;
+
+  // Hooks called by GradNode while the profiler is active.
+
+  /// Called before an operator builds its node.
+  void BeginOp(GradNode::Op op);
+  /// Called once the operator's node is complete.
+  void EndOp();
+  /// Called when a node of node_bytes bytes is constructed.
+  void RecordNode(size_t live_nodes, size_t node_bytes);
+  /// Called when a node is constructed with a custom backward function.
+  void RecordCustomNode(size_t live_nodes, size_t node_bytes);
+  /// Called around a topological sort.
+  void BeginSort();
+  void EndSort();
+  /// Called around the backward functions of a backward pass.
+  void BeginBackward();
+  void EndBackward();
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  /// A complete event of the timeline.
+  struct Event {
+    const char *name;
+    int64_t begin_ns; // Relative to the creation of the profiler.
+    int64_t end_ns;
+  };
+
+  /// Nanoseconds since the creation of the profiler.
+  int64_t Now() const;
+
+  /// Adds the pending construction event, if any, to the timeline.
+  void FlushConstruction();
+
+  Profiler *previous_; // The profiler active when this one was created.
+  Clock::time_point origin_; // Time zero of the timeline.
+  ProfileStats stats_;
+  std::vector<Event> events_;
+  GradNode::Op current_op_ = GradNode::Op::kLeaf; // Op being built, if any.
+  int64_t op_begin_ns_ = 0;
+  // Span of the operators run since the last other event, or -1.
+  int64_t construction_begin_ns_ = -1;
+  int64_t construction_end_ns_ = -1;
+  int64_t sort_begin_ns_ = 0;
+  int64_t backward_begin_ns_ = 0;
+  int backward_depth_ = 0; // Number of backward passes in progress.
+  std::vector<int64_t> step_begin_ns_; // Begin of the open steps.
+};
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // PROFILER_H
@@ -0,0 +1,117 @@
+#include "profiler.h"
+#include "micrograd.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+size_t Created(const Profiler &profiler, GradNode::Op op) {
+  return profiler.Stats().nodes_created[static_cast<size_t>(op)];
+}
+
+TEST(ProfilerTest, CountsNodesPerOp) {
+  Profiler profiler;
+  auto a = GradNode::CreateGradnode(2.0, "a");
+  auto b = GradNode::CreateGradnode(3.0, "b");
+  auto c = a * b + 1.0;
+  auto z = sigmoid(c);
+  auto custom = GradNode::CreateGradnode(1.0, "custom", {z}, []() {});
+
+  EXPECT_EQ(Created(profiler, GradNode::Op::kLeaf), 2);
+  EXPECT_EQ(Created(profiler, GradNode::Op::kMul), 1);
+  EXPECT_EQ(Created(profiler, GradNode::Op::kAddConstant), 1);
+  EXPECT_EQ(Created(profiler, GradNode::Op::kSigmoid), 1);
+  EXPECT_EQ(Created(profiler, GradNode::Op::kCustom), 1);
+  EXPECT_EQ(Created(profiler, GradNode::Op::kAdd), 0);
+  EXPECT_GE(profiler.Stats().peak_live_nodes, 6);
+  EXPECT_EQ(profiler.Stats().peak_node_object_bytes,
+            profiler.Stats().peak_live_nodes * sizeof(GradNode));
+}
+
+TEST(ProfilerTest, OnlyActiveInScope) {
+  auto a = GradNode::CreateGradnode(2.0, "a");
+  Profiler outer;
+  {
+    Profiler inner;
+    EXPECT_EQ(Profiler::Active(), &inner);
+    auto z = a * a;
+    EXPECT_EQ(Created(inner, GradNode::Op::kMul), 1);
+  }
+  EXPECT_EQ(Profiler::Active(), &outer);
+  EXPECT_EQ(Created(outer, GradNode::Op::kMul), 0);
+
+  outer.Reset();
+  EXPECT_EQ(outer.Stats().peak_live_nodes, 0);
+}
+
+TEST(ProfilerTest, ChromeTrace) {
+  Profiler profiler;
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  for (int step = 0; step < 2; step++) {
+    profiler.BeginStep();
+    auto diff = w * 3.0 - 1.0;
+    auto loss = pow(diff, 2.0);
+    loss->Backward();
+    profiler.EndStep();
+  }
+
+  auto json = profiler.ChromeTraceJson();
+  EXPECT_EQ(json.rfind("{\"traceEvents\":[", 0), 0);
+  for (auto name : {"construction", "sort", "backward", "step"}) {
+    EXPECT_NE(json.find(std::string("\"name\":\"") + name + "\""),
+              std::string::npos)
+        << name;
+  }
+  EXPECT_GT(profiler.Stats().construction_ns, 0);
+  EXPECT_GT(profiler.Stats().sort_ns + profiler.Stats().backward_ns, 0);
+  EXPECT_NE(profiler.Report().find("pow_constant"), std::string::npos);
+}
+
+size_t CountEvents(const Profiler &profiler, const std::string &name) {
+  auto json = profiler.ChromeTraceJson();
+  auto key = "\"name\":\"" + name + "\"";
+  size_t count = 0;
+  for (auto pos = json.find(key); pos != std::string::npos;
+       pos = json.find(key, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+// A backward pass run by a custom backward function is part of the outer one.
+TEST(ProfilerTest, NestedBackwardIsOneEvent) {
+  Profiler profiler;
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto inner = w * w;
+  auto outer = GradNode::CreateGradnode(1.0, "outer", {w},
+                                        [&inner]() { inner->Backward(); });
+  outer->Backward();
+
+  EXPECT_EQ(w->GetGrad(), 1.0);
+  EXPECT_EQ(CountEvents(profiler, "backward"), 1);
+}
+
+// A backward function that throws still ends the backward pass.
+TEST(ProfilerTest, ThrowingBackwardEndsPass) {
+  Profiler profiler;
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto failing = GradNode::CreateGradnode(
+      1.0, "failing", {w}, []() { throw std::runtime_error("backward"); });
+  EXPECT_THROW(failing->Backward(), std::runtime_error);
+  EXPECT_EQ(CountEvents(profiler, "backward"), 1);
+
+  auto loss = w * w;
+  loss->Backward();
+  EXPECT_EQ(CountEvents(profiler, "backward"), 2);
+  EXPECT_GT(profiler.Stats().backward_ns, 0);
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
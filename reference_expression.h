@@ -0,0 +1,33 @@
+#ifndef REFERENCE_EXPRESSION_H
+#define REFERENCE_EXPRESSION_H
+
+namespace apexkid {
+namespace micrograd {
+
+/**
+ * @brief Builds the expression the tests of every front end differentiate
+ * and compare against GradNode.
+ *
+ * It uses each elementwise operation the front ends share, so one formula
+ * covers GradNode, StaticGraph, BatchGraph, GradientGraph, the expression
+ * templates and Dual. The arguments may be any subexpressions of one front
+ * end, and the operations are found by argument-dependent lookup. They are
+ * taken by value because pow() on GradNode takes non-const references.
+ * @param w A subexpression, which must not be 0.
+ * @param b A subexpression.
+ * @param e A subexpression used as an exponent.
+ * @return The expression.
+ */
+template <typename W, typename B, typename E>
+auto ReferenceExpression(W w, B b, E e) {
+  auto z = w * 3.0 + b;
+  auto s = sigmoid(z);
+  auto t = tanh(z);
+  return log(s) + t * relu(z) / (1.0 + s) - 2.0 * pow(s, e) + 1.0 / w +
+         pow(t, 3) - 4.0;
+}
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // REFERENCE_EXPRESSION_H
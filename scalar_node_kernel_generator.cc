@@ -0,0 +1,29 @@
+#include "codegen.h"
+#include "micrograd.h"
+#include <iostream>
+using namespace apexkid::micrograd;
+
+// Generates the kernels of w*2*w + x where w*2 is marked with MakeScalar(),
+// so that codegen_test can check the kernel passes no gradient through it.
+// The input is {x} and the parameter {w}.
+//
+// Usage: scalar_node_kernel_generator <header> <source>
+// Run by the micrograd_kernel rule in BUILD; see codegen.bzl.
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <header> <source>" << std::endl;
+    return 1;
+  }
+
+  auto w = GradNode::CreateGradnode(0.0, "w");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto t = w * 2.0;
+  t->MakeScalar();
+  CodeGenerator generator(t * w + x, {x});
+
+  if (!generator.WriteFiles("ScalarNode", argv[1], argv[2])) {
+    std::cerr << "Could not write the kernel" << std::endl;
+    return 1;
+  }
+  return 0;
+}
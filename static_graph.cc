@@ -0,0 +1,189 @@
+#include "static_graph.h"
+#include "graph.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+namespace {
+
+// Gets the bit pattern of a constant. Unlike the value, it orders NaN like
+// any other constant.
+uint64_t Bits(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+} // namespace
+
+StaticGraph::StaticGraph(std::shared_ptr<GradNode> output,
+                         std::vector<std::shared_ptr<GradNode>> inputs)
+    : output_(std::move(output)), inputs_(std::move(inputs)) {
+  for (auto &input : inputs_) {
+    if (!input->children_.empty()) {
+      throw std::invalid_argument("StaticGraph inputs must be leaf nodes");
+    }
+  }
+
+  std::vector<GradNode *> order;
+  internal::TopologicalSort(output_.get(), &order);
+  for (auto *node : order) {
+    if (node->children_.empty()) {
+      continue;
+    }
+    if (node->op_ == GradNode::Op::kCustom) {
+      throw std::invalid_argument("StaticGraph cannot recompute custom nodes");
+    }
+    interior_.push_back(node);
+  }
+  backward_ = interior_;
+}
+
+double StaticGraph::Forward(const std::vector<double> &inputs) {
+  if (inputs.size() != inputs_.size()) {
+    throw std::invalid_argument("StaticGraph input count does not match");
+  }
+  for (size_t i = 0; i < inputs.size(); i++) {
+    inputs_[i]->data_ = inputs[i];
+  }
+  for (auto *node : interior_) {
+    node->Recompute();
+  }
+  return output_->data_;
+}
+
+void StaticGraph::Backward() {
+  for (auto &input : inputs_) {
+    input->grad_ = 0.0;
+  }
+  for (auto *node : interior_) {
+    node->grad_ = 0.0;
+  }
+  output_->grad_ = 1.0;
+  for (auto it = backward_.rbegin(); it != backward_.rend(); ++it) {
+    (*it)->backward_fn_();
+  }
+}
+
+OptimizeStats StaticGraph::Optimize() {
+  OptimizeStats stats;
+  std::vector<GradNode *> order;
+  internal::TopologicalSort(output_.get(), &order);
+
+  // Owners of the nodes, for rewiring children to them.
+  std::unordered_map<GradNode *, std::shared_ptr<GradNode>> owners;
+  owners[output_.get()] = output_;
+  for (auto *node : order) {
+    for (auto &child : node->children_) {
+      owners[child.get()] = child;
+    }
+  }
+  std::unordered_set<GradNode *> inputs;
+  for (auto &input : inputs_) {
+    inputs.insert(input.get());
+  }
+
+  // An operation on given children, which identical nodes share. Constants
+  // are compared by their bits.
+  using Key = std::tuple<GradNode::Op, std::vector<GradNode *>, uint64_t,
+                         std::vector<uint64_t>>;
+  std::map<Key, GradNode *> computed;
+  std::unordered_map<GradNode *, GradNode *> representative;
+  std::unordered_set<GradNode *> constants;
+  std::unordered_set<GradNode *> needs_grad;
+
+  for (auto *node : order) {
+    if (node->children_.empty()) {
+      if (!node->is_scalar_) {
+        needs_grad.insert(node);
+      } else if (inputs.count(node) == 0) {
+        constants.insert(node);
+      }
+      continue;
+    }
+
+    bool all_constant = true;
+    bool any_needs_grad = false;
+    std::vector<GradNode *> children;
+    for (auto &child : node->children_) {
+      all_constant = all_constant && constants.count(child.get()) > 0;
+      any_needs_grad = any_needs_grad || needs_grad.count(child.get()) > 0;
+      auto found = representative.find(child.get());
+      children.push_back(found != representative.end() ? found->second
+                                                       : child.get());
+    }
+
+    if (all_constant) {
+      node->op_ = GradNode::Op::kLeaf;
+      node->children_.clear();
+      node->backward_fn_ = nullptr;
+      node->is_scalar_ = true;
+      constants.insert(node);
+      stats.folded++;
+      continue;
+    }
+
+    if (node->op_ == GradNode::Op::kAdd || node->op_ == GradNode::Op::kMul) {
+      std::sort(children.begin(), children.end());
+    }
+    std::vector<uint64_t> operands;
+    operands.reserve(node->operands_.size());
+    for (auto operand : node->operands_) {
+      operands.push_back(Bits(operand));
+    }
+    Key key(node->op_, std::move(children), Bits(node->operand_),
+            std::move(operands));
+    auto inserted = computed.emplace(std::move(key), node);
+    if (!inserted.second) {
+      auto *earlier = inserted.first->second;
+      node->op_ = GradNode::Op::kAddConstant;
+      node->operand_ = 0.0;
+      node->operands_.clear();
+      node->children_ = {owners[earlier]};
+      node->backward_fn_ = [earlier, node]() {
+        if (!earlier->is_scalar_) {
+          GradNode::PropagateGrad(earlier, node->grad_);
+        }
+      };
+      representative[node] = earlier;
+      stats.deduplicated++;
+    }
+    if (any_needs_grad) {
+      needs_grad.insert(node);
+    }
+  }
+  // Cached sort orders include the children replaced above.
+  GradNode::NextGraphGeneration();
+
+  internal::TopologicalSort(output_.get(), &order);
+  interior_.clear();
+  backward_.clear();
+  for (auto *node : order) {
+    if (node->children_.empty()) {
+      continue;
+    }
+    interior_.push_back(node);
+    if (needs_grad.count(node) > 0) {
+      backward_.push_back(node);
+    } else {
+      stats.pruned++;
+    }
+  }
+  return stats;
+}
+
+} // namespace micrograd
+} // namespace apexkid
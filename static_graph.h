@@ -0,0 +1,117 @@
+#ifndef STATIC_GRAPH_H
+#define STATIC_GRAPH_H
+
+#include "micrograd.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+/// What StaticGraph::Optimize() changed.
+struct OptimizeStats {
+  size_t folded = 0;       // Nodes replaced by the constant they evaluate to.
+  size_t deduplicated = 0; // Nodes turned into aliases of an identical node.
+  size_t pruned = 0;       // Nodes whose backward step is skipped.
+};
+
+/**
+ * @class StaticGraph
+ * @brief A GradNode graph captured once and evaluated many times.
+ *
+ * A fixed-shape model builds the same graph for every sample. StaticGraph
+ * records such a graph once, with leaf nodes as placeholders for the inputs,
+ * and then re-evaluates it in place: Forward() writes new input values and
+ * recomputes every node in topological order, and Backward() reruns the
+ * recorded backward functions over the same order. Neither allocates nor
+ * sorts.
+ *
+ * Leaves other than the placeholders, such as parameters, are shared with the
+ * caller: Forward() reads their current values and Backward() accumulates into
+ * their gradients, as GradNode::Backward() does. The graph must not be
+ * released with GradNode::ReleaseGraph() while it is captured.
+ */
+class StaticGraph {
+public:
+  /**
+   * @brief Captures the graph computing an output.
+   * @param output The node computing the result of the graph.
+   * @param inputs The leaf nodes whose values Forward() sets, in order.
+   * @throws std::invalid_argument If an input is not a leaf, or the graph
+   * contains a custom node that cannot be recomputed.
+   */
+  StaticGraph(std::shared_ptr<GradNode> output,
+              std::vector<std::shared_ptr<GradNode>> inputs);
+
+  /**
+   * @brief Evaluates the graph for new input values.
+   * @param inputs The values of the inputs, in the order they were captured.
+   * @return The value of the output.
+   * @throws std::invalid_argument If the number of values does not match the
+   * number of inputs.
+   */
+  double Forward(const std::vector<double> &inputs);
+
+  /**
+   * @brief Computes gradients of the output for the last Forward().
+   *
+   * The gradients of the output, interior nodes and inputs are reset first;
+   * the gradients of other leaves are accumulated into.
+   */
+  void Backward();
+
+  /**
+   * @brief Simplifies the captured graph before it is replayed.
+   *
+   * Three passes run over the nodes in topological order:
+   * - Constant folding: a node whose children are all constants becomes a
+   *   constant leaf holding its current value. Constants are leaves marked
+   *   with MakeScalar() that are not inputs, and folded nodes.
+   * - Common subexpression elimination: a node computing the same operation
+   *   on the same children as an earlier node becomes `earlier + 0.0`, which
+   *   copies its value forward and passes its gradient back. The children of
+   *   add and mul nodes match in either order.
+   * - Pruning: nodes no longer reachable from the output are no longer
+   *   recomputed, and nodes with no non-constant leaf below them skip their
+   *   backward step.
+   *
+   * The passes rewrite the nodes in place, so the graph keeps giving the same
+   * values and gradients through GradNode::Backward() as well. Constant
+   * leaves must not change value afterwards.
+   *
+   * Nodes shared with other graphs are rewritten too. Another StaticGraph,
+   * BatchGraph or CodeGenerator that captured any of them before is
+   * invalidated and must be rebuilt, so optimize a graph before capturing
+   * the graphs it shares nodes with.
+   * @return What was changed.
+   */
+  OptimizeStats Optimize();
+
+  /**
+   * @brief Gets the output node.
+   * @return The output node.
+   */
+  const std::shared_ptr<GradNode> &GetOutput() const { return output_; }
+
+  /**
+   * @brief Gets the number of nodes recomputed by Forward().
+   * @return The number of interior nodes, including the output.
+   */
+  size_t Size() const { return interior_.size(); }
+
+private:
+  std::shared_ptr<GradNode> output_;              // Keeps the graph alive.
+  std::vector<std::shared_ptr<GradNode>> inputs_; // Placeholder leaves.
+  // Non-leaf nodes with every child before its parents, so the output comes
+  // last.
+  std::vector<GradNode *> interior_;
+  // The nodes of interior_ whose backward step runs, in the same order.
+  std::vector<GradNode *> backward_;
+};
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // STATIC_GRAPH_H
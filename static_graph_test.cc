@@ -0,0 +1,202 @@
+#include "static_graph.h"
+#include "micrograd.h"
+#include "reference_expression.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+TEST(StaticGraphTest, ForwardRecomputesOutput) {
+  auto w = GradNode::CreateGradnode(3.0, "w");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto y = GradNode::CreateGradnode(0.0, "y");
+  auto diff = w * x - y;
+  auto loss = pow(diff, 2);
+  StaticGraph graph(loss, {x, y});
+
+  EXPECT_EQ(graph.Forward({2.0, 1.0}), 25.0);
+  EXPECT_EQ(graph.Forward({1.0, 1.0}), 4.0);
+  w->SetData(1.0);
+  EXPECT_EQ(graph.Forward({1.0, 1.0}), 0.0);
+  EXPECT_EQ(graph.Size(), 3);
+}
+
+TEST(StaticGraphTest, BackwardMatchesRebuiltGraph) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto b = GradNode::CreateGradnode(-0.25, "b");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto out = ReferenceExpression(w * x + b, b, w);
+  StaticGraph graph(out, {x});
+
+  for (double input : {-2.0, 0.1, 3.0}) {
+    w->ZeroGrad();
+    b->ZeroGrad();
+    auto value = graph.Forward({input});
+    graph.Backward();
+    auto w_grad = w->GetGrad();
+    auto b_grad = b->GetGrad();
+    auto x_grad = x->GetGrad();
+
+    auto w2 = GradNode::CreateGradnode(0.5, "w");
+    auto b2 = GradNode::CreateGradnode(-0.25, "b");
+    auto x2 = GradNode::CreateGradnode(input, "x");
+    auto out2 = ReferenceExpression(w2 * x2 + b2, b2, w2);
+    out2->Backward();
+
+    EXPECT_EQ(value, out2->GetData());
+    EXPECT_EQ(w_grad, w2->GetGrad());
+    EXPECT_EQ(b_grad, b2->GetGrad());
+    EXPECT_EQ(x_grad, x2->GetGrad());
+  }
+}
+
+TEST(StaticGraphTest, ReplaysReductions) {
+  auto w1 = GradNode::CreateGradnode(0.5, "w1");
+  auto w2 = GradNode::CreateGradnode(-1.5, "w2");
+  auto x1 = GradNode::CreateGradnode(0.0, "x1");
+  auto x2 = GradNode::CreateGradnode(0.0, "x2");
+  auto z = Sum({Dot({w1, w2}, {x1, x2}), Dot({w1, w2}, {2.0, 3.0}), w1});
+  StaticGraph graph(z, {x1, x2});
+
+  EXPECT_EQ(graph.Forward({4.0, 2.0}), -1.0 - 3.5 + 0.5);
+  graph.Backward();
+  EXPECT_EQ(w1->GetGrad(), 4.0 + 2.0 + 1.0);
+  EXPECT_EQ(w2->GetGrad(), 2.0 + 3.0);
+  EXPECT_EQ(x2->GetGrad(), -1.5);
+}
+
+TEST(StaticGraphTest, BackwardAccumulatesIntoParameters) {
+  auto w = GradNode::CreateGradnode(2.0, "w");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto z = w * x;
+  StaticGraph graph(z, {x});
+
+  graph.Forward({3.0});
+  graph.Backward();
+  graph.Forward({4.0});
+  graph.Backward();
+
+  EXPECT_EQ(w->GetGrad(), 7.0);
+  EXPECT_EQ(x->GetGrad(), 2.0);
+  EXPECT_EQ(z->GetGrad(), 1.0);
+}
+
+TEST(StaticGraphTest, RejectsInvalidGraphs) {
+  auto a = GradNode::CreateGradnode(1.0, "a");
+  auto b = GradNode::CreateGradnode(2.0, "b");
+  auto sum = a + b;
+  EXPECT_THROW(StaticGraph(sum * 2.0, {sum}), std::invalid_argument);
+
+  auto custom = GradNode::CreateGradnode(3.0, "c", {a}, []() {});
+  EXPECT_THROW(StaticGraph(custom + b, {a}), std::invalid_argument);
+
+  StaticGraph graph(sum, {a, b});
+  EXPECT_THROW(graph.Forward({1.0}), std::invalid_argument);
+}
+
+TEST(StaticGraphTest, OptimizeFoldsConstants) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto c = GradNode::CreateGradnode(2.0, "c");
+  c->MakeScalar();
+  auto cubed = pow(c, 3);
+  auto scale = cubed + 1.0;
+  auto out = w * x * scale;
+  StaticGraph graph(out, {x});
+
+  auto stats = graph.Optimize();
+
+  EXPECT_EQ(stats.folded, 2);
+  EXPECT_EQ(graph.Size(), 2);
+  EXPECT_EQ(graph.Forward({3.0}), 0.5 * 3.0 * 9.0);
+  graph.Backward();
+  EXPECT_EQ(w->GetGrad(), 27.0);
+  EXPECT_EQ(x->GetGrad(), 4.5);
+}
+
+TEST(StaticGraphTest, OptimizeEliminatesCommonSubexpressions) {
+  auto build = [](std::shared_ptr<GradNode> w, std::shared_ptr<GradNode> x) {
+    auto z = w * x;
+    auto t1 = tanh(z);
+    auto t2 = tanh(z);
+    return t1 * t2 + x * w;
+  };
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  StaticGraph graph(build(w, x), {x});
+
+  auto stats = graph.Optimize();
+
+  EXPECT_EQ(stats.deduplicated, 2);
+  for (double input : {-2.0, 0.1, 3.0}) {
+    w->ZeroGrad();
+    auto value = graph.Forward({input});
+    graph.Backward();
+
+    auto w2 = GradNode::CreateGradnode(0.5, "w");
+    auto x2 = GradNode::CreateGradnode(input, "x");
+    auto out2 = build(w2, x2);
+    out2->Backward();
+
+    EXPECT_EQ(value, out2->GetData());
+    EXPECT_NEAR(w->GetGrad(), w2->GetGrad(), 1e-12);
+    EXPECT_NEAR(x->GetGrad(), x2->GetGrad(), 1e-12);
+  }
+
+  // The rewritten graph still differentiates through GradNode::Backward().
+  auto w3 = GradNode::CreateGradnode(0.5, "w");
+  auto x3 = GradNode::CreateGradnode(0.0, "x");
+  StaticGraph eager(build(w3, x3), {x3});
+  eager.Optimize();
+  eager.Forward({0.1});
+  eager.GetOutput()->Backward();
+  auto w2 = GradNode::CreateGradnode(0.5, "w");
+  auto x2 = GradNode::CreateGradnode(0.1, "x");
+  auto out2 = build(w2, x2);
+  out2->Backward();
+  EXPECT_NEAR(w3->GetGrad(), w2->GetGrad(), 1e-12);
+  EXPECT_NEAR(x3->GetGrad(), x2->GetGrad(), 1e-12);
+}
+
+// NaN constants are deduplicated by their bits, like any other constant.
+TEST(StaticGraphTest, OptimizeEliminatesNaNConstants) {
+  auto nan = std::numeric_limits<double>::quiet_NaN();
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  auto out = Sum({x * nan, x * 2.0, x * nan, x * 3.0, x * 2.0});
+  StaticGraph graph(out, {x});
+
+  auto stats = graph.Optimize();
+
+  EXPECT_EQ(stats.deduplicated, 2);
+  EXPECT_TRUE(std::isnan(graph.Forward({1.0})));
+}
+
+TEST(StaticGraphTest, OptimizePrunesBackwardSteps) {
+  auto w = GradNode::CreateGradnode(0.5, "w");
+  auto x = GradNode::CreateGradnode(0.0, "x");
+  x->MakeScalar();
+  auto scaled = x * 2.0;
+  auto feature = tanh(scaled);
+  auto out = w * feature;
+  StaticGraph graph(out, {x});
+
+  auto stats = graph.Optimize();
+
+  EXPECT_EQ(stats.folded, 0);
+  EXPECT_EQ(stats.pruned, 2);
+  EXPECT_EQ(graph.Size(), 3);
+  graph.Forward({0.25});
+  graph.Backward();
+  EXPECT_EQ(w->GetGrad(), std::tanh(0.5));
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
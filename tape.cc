@@ -0,0 +1,178 @@
+#include "tape.h"
+#include "numeric.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+double Var::GetData() const { return tape_->data_[index_]; }
+double Var::GetGrad() const { return tape_->grad_[index_]; }
+
+Var Tape::Record(Op op, uint32_t lhs, uint32_t rhs, double data) {
+  auto index = static_cast<uint32_t>(ops_.size());
+  ops_.push_back(op);
+  lhs_.push_back(lhs);
+  rhs_.push_back(rhs);
+  data_.push_back(data);
+  grad_.push_back(0.0);
+  return Var(this, index);
+}
+
+Var Tape::Leaf(double data) { return Record(Op::kLeaf, 0, 0, data); }
+
+Var Tape::Constant(double data) { return Record(Op::kConstant, 0, 0, data); }
+
+void Tape::Clear() {
+  ops_.clear();
+  lhs_.clear();
+  rhs_.clear();
+  data_.clear();
+  grad_.clear();
+}
+
+void Tape::Reserve(size_t capacity) {
+  ops_.reserve(capacity);
+  lhs_.reserve(capacity);
+  rhs_.reserve(capacity);
+  data_.reserve(capacity);
+  grad_.reserve(capacity);
+}
+
+void Tape::Backward(Var root) {
+  assert(root.tape_ == this);
+  std::fill(grad_.begin(), grad_.end(), 0.0);
+  grad_[root.index_] = 1.0;
+
+  // Children precede their parents, so a reverse sweep visits every entry
+  // after all of its consumers.
+  for (size_t i = root.index_ + 1; i-- > 0;) {
+    auto grad = grad_[i];
+    if (grad == 0.0) {
+      continue;
+    }
+    auto lhs = lhs_[i];
+    auto rhs = rhs_[i];
+    switch (ops_[i]) {
+    case Op::kLeaf:
+    case Op::kConstant:
+      break;
+    case Op::kAdd:
+      grad_[lhs] += grad;
+      grad_[rhs] += grad;
+      break;
+    case Op::kSub:
+      grad_[lhs] += grad;
+      grad_[rhs] -= grad;
+      break;
+    case Op::kMul:
+      grad_[lhs] += grad * data_[rhs];
+      grad_[rhs] += grad * data_[lhs];
+      break;
+    case Op::kDiv:
+      grad_[lhs] += grad / data_[rhs];
+      grad_[rhs] -= grad * data_[lhs] / (data_[rhs] * data_[rhs]);
+      break;
+    case Op::kPow:
+      grad_[lhs] +=
+          grad * data_[rhs] * std::pow(data_[lhs], data_[rhs] - 1);
+      if (ops_[rhs] != Op::kConstant) {
+        grad_[rhs] += grad * data_[i] * std::log(data_[lhs]);
+      }
+      break;
+    case Op::kLog:
+      grad_[lhs] += grad / data_[lhs];
+      break;
+    case Op::kSigmoid:
+      grad_[lhs] += grad * data_[i] * (1.0 - data_[i]);
+      break;
+    case Op::kTanh:
+      grad_[lhs] += grad * (1.0 - data_[i] * data_[i]);
+      break;
+    case Op::kRelu:
+      if (data_[lhs] > 0) {
+        grad_[lhs] += grad;
+      }
+      break;
+    }
+  }
+}
+
+Var operator+(double a, Var b) { return b.GetTape()->Constant(a) + b; }
+
+Var operator+(Var a, double b) { return a + a.GetTape()->Constant(b); }
+
+Var operator+(Var a, Var b) {
+  assert(a.GetTape() == b.GetTape());
+  return a.GetTape()->Record(Tape::Op::kAdd, a.GetIndex(), b.GetIndex(),
+                             a.GetData() + b.GetData());
+}
+
+Var operator-(double a, Var b) { return b.GetTape()->Constant(a) - b; }
+
+Var operator-(Var a, double b) { return a - a.GetTape()->Constant(b); }
+
+Var operator-(Var a, Var b) {
+  assert(a.GetTape() == b.GetTape());
+  return a.GetTape()->Record(Tape::Op::kSub, a.GetIndex(), b.GetIndex(),
+                             a.GetData() - b.GetData());
+}
+
+Var operator*(double a, Var b) { return b.GetTape()->Constant(a) * b; }
+
+Var operator*(Var a, double b) { return a * a.GetTape()->Constant(b); }
+
+Var operator*(Var a, Var b) {
+  assert(a.GetTape() == b.GetTape());
+  return a.GetTape()->Record(Tape::Op::kMul, a.GetIndex(), b.GetIndex(),
+                             a.GetData() * b.GetData());
+}
+
+Var operator/(double a, Var b) { return b.GetTape()->Constant(a) / b; }
+
+Var operator/(Var a, double b) { return a / a.GetTape()->Constant(b); }
+
+Var operator/(Var a, Var b) {
+  assert(a.GetTape() == b.GetTape());
+  return a.GetTape()->Record(Tape::Op::kDiv, a.GetIndex(), b.GetIndex(),
+                             a.GetData() / b.GetData());
+}
+
+Var pow(Var base, double exponent) {
+  return pow(base, base.GetTape()->Constant(exponent));
+}
+
+Var pow(Var base, Var exponent) {
+  assert(base.GetTape() == exponent.GetTape());
+  return base.GetTape()->Record(Tape::Op::kPow, base.GetIndex(),
+                                exponent.GetIndex(),
+                                std::pow(base.GetData(), exponent.GetData()));
+}
+
+Var log(Var x) {
+  return x.GetTape()->Record(Tape::Op::kLog, x.GetIndex(), x.GetIndex(),
+                             std::log(x.GetData()));
+}
+
+Var sigmoid(Var x) {
+  return x.GetTape()->Record(Tape::Op::kSigmoid, x.GetIndex(), x.GetIndex(),
+                             internal::StableSigmoid(x.GetData()));
+}
+
+Var tanh(Var x) {
+  return x.GetTape()->Record(Tape::Op::kTanh, x.GetIndex(), x.GetIndex(),
+                             std::tanh(x.GetData()));
+}
+
+Var relu(Var x) {
+  return x.GetTape()->Record(Tape::Op::kRelu, x.GetIndex(), x.GetIndex(),
+                             std::max(x.GetData(), 0.0));
+}
+
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,220 @@
+#ifndef TAPE_H
+#define TAPE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+class Tape;
+
+/**
+ * @class Var
+ * @brief A lightweight handle to a value recorded on a Tape.
+ *
+ * A Var is just a (tape, index) pair, so it is cheap to copy and creating one
+ * never allocates. It supports the same operator vocabulary as GradNode.
+ */
+class Var {
+public:
+  Var() = default;
+
+  /**
+   * @brief Gets the data value of the recorded entry.
+   * @return The data value.
+   */
+  double GetData() const;
+
+  /**
+   * @brief Gets the gradient value of the recorded entry.
+   * @return The gradient value.
+   */
+  double GetGrad() const;
+
+  /**
+   * @brief Gets the index of the entry on its tape.
+   * @return The tape index.
+   */
+  uint32_t GetIndex() const { return index_; }
+
+  /**
+   * @brief Gets the tape the entry was recorded on.
+   * @return A pointer to the owning tape.
+   */
+  Tape *GetTape() const { return tape_; }
+
+private:
+  friend class Tape;
+
+  Var(Tape *tape, uint32_t index) : tape_(tape), index_(index) {}
+
+  Tape *tape_ = nullptr; // The tape owning the entry.
+  uint32_t index_ = 0;   // The position of the entry on the tape.
+};
+
+/**
+ * @class Tape
+ * @brief A contiguous recording of a computation for automatic
+ * differentiation.
+ *
+ * Operations on Var handles are appended to the tape as a struct-of-arrays
+ * (op code, child indices, data, grad). Since children are always recorded
+ * before their parents, the tape is already in topological order and the
+ * backward pass is a single reverse sweep. Clear() keeps the capacity of the
+ * arrays, so a warmed-up tape records and differentiates without allocating.
+ */
+class Tape {
+public:
+  /// The operation that produced a tape entry.
+  enum class Op : uint8_t {
+    kLeaf,
+    kConstant,
+    kAdd,
+    kSub,
+    kMul,
+    kDiv,
+    kPow,
+    kLog,
+    kSigmoid,
+    kTanh,
+    kRelu,
+  };
+
+  Tape() = default;
+
+  // Vars point back at their tape, so a tape cannot be copied or moved.
+  Tape(const Tape &) = delete;
+  Tape &operator=(const Tape &) = delete;
+
+  /**
+   * @brief Records a leaf value whose gradient is tracked.
+   * @param data The value of the leaf.
+   * @return A handle to the recorded leaf.
+   */
+  Var Leaf(double data);
+
+  /**
+   * @brief Records a constant value whose gradient is not tracked.
+   * @param data The value of the constant.
+   * @return A handle to the recorded constant.
+   */
+  Var Constant(double data);
+
+  /**
+   * @brief Performs a backward pass to compute gradients.
+   *
+   * Gradients from a previous backward pass are discarded. Only entries
+   * recorded before the root take part in the sweep.
+   * @param root The entry to differentiate.
+   */
+  void Backward(Var root);
+
+  /**
+   * @brief Removes all entries while keeping the allocated capacity.
+   */
+  void Clear();
+
+  /**
+   * @brief Reserves capacity for a number of entries.
+   * @param capacity The number of entries to reserve.
+   */
+  void Reserve(size_t capacity);
+
+  /**
+   * @brief Gets the number of recorded entries.
+   * @return The number of entries.
+   */
+  size_t Size() const { return ops_.size(); }
+
+  /**
+   * @brief Gets the number of entries that fit without reallocating.
+   * @return The allocated capacity, in entries.
+   */
+  size_t Capacity() const { return ops_.capacity(); }
+
+  // Overloaded operators for arithmetic operations
+
+  /// Addition
+  friend Var operator+(double a, Var b);
+  friend Var operator+(Var a, double b);
+  friend Var operator+(Var a, Var b);
+
+  /// Subtraction
+  friend Var operator-(double a, Var b);
+  friend Var operator-(Var a, double b);
+  friend Var operator-(Var a, Var b);
+
+  /// Multiplication
+  friend Var operator*(double a, Var b);
+  friend Var operator*(Var a, double b);
+  friend Var operator*(Var a, Var b);
+
+  /// Division
+  friend Var operator/(double a, Var b);
+  friend Var operator/(Var a, double b);
+  friend Var operator/(Var a, Var b);
+
+  /// Power
+  friend Var pow(Var base, double exponent);
+  friend Var pow(Var base, Var exponent);
+
+  /// Log
+  friend Var log(Var x);
+
+  /// Sigmoid
+  friend Var sigmoid(Var x);
+
+  /// Tanh
+  friend Var tanh(Var x);
+
+  /// ReLU
+  friend Var relu(Var x);
+
+private:
+  friend class Var;
+
+  /**
+   * @brief Appends an entry to the tape.
+   * @param op The operation that produced the entry.
+   * @param lhs The index of the first child.
+   * @param rhs The index of the second child.
+   * @param data The value of the entry.
+   * @return A handle to the recorded entry.
+   */
+  Var Record(Op op, uint32_t lhs, uint32_t rhs, double data);
+
+  /// Private members
+  std::vector<Op> ops_;        // Operation per entry.
+  std::vector<uint32_t> lhs_;  // First child index per entry.
+  std::vector<uint32_t> rhs_;  // Second child index per entry.
+  std::vector<double> data_;   // Value per entry.
+  std::vector<double> grad_;   // Gradient per entry.
+};
+
+// Namespace-scope declarations so that the operators are found for Var
+// arguments, which do not bring Tape's friends into scope.
+Var operator+(double a, Var b);
+Var operator+(Var a, double b);
+Var operator+(Var a, Var b);
+Var operator-(double a, Var b);
+Var operator-(Var a, double b);
+Var operator-(Var a, Var b);
+Var operator*(double a, Var b);
+Var operator*(Var a, double b);
+Var operator*(Var a, Var b);
+Var operator/(double a, Var b);
+Var operator/(Var a, double b);
+Var operator/(Var a, Var b);
+Var pow(Var base, double exponent);
+Var pow(Var base, Var exponent);
+Var log(Var x);
+Var sigmoid(Var x);
+Var tanh(Var x);
+Var relu(Var x);
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // TAPE_H
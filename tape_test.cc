@@ -0,0 +1,125 @@
+#include "tape.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+TEST(TapeTest, Sum) {
+  Tape tape;
+  auto a = tape.Leaf(1.0);
+  auto b = tape.Leaf(1.0);
+
+  auto z = a + b;
+  tape.Backward(z);
+
+  EXPECT_EQ(a.GetGrad(), 1.0);
+  EXPECT_EQ(b.GetGrad(), 1.0);
+  EXPECT_EQ(z.GetGrad(), 1.0);
+  EXPECT_EQ(z.GetData(), 2.0);
+}
+
+TEST(TapeTest, Divide) {
+  Tape tape;
+  auto a = tape.Leaf(2.0);
+  auto b = tape.Leaf(4.0);
+
+  auto z = a / b;
+  tape.Backward(z);
+
+  EXPECT_EQ(a.GetGrad(), 0.25);
+  EXPECT_EQ(b.GetGrad(), -(2.0 / 16));
+  EXPECT_EQ(z.GetData(), 0.5);
+}
+
+TEST(TapeTest, Power) {
+  Tape tape;
+  auto a = tape.Leaf(2.0);
+  auto b = tape.Leaf(3.0);
+
+  auto z = pow(a, b);
+  tape.Backward(z);
+
+  EXPECT_EQ(a.GetGrad(), 12.0);
+  EXPECT_EQ(b.GetGrad(), 8.0 * std::log(2.0));
+  EXPECT_EQ(z.GetData(), 8.0);
+}
+
+// Z = ((A^2 + B^2) / (A - B)) + 3AB
+TEST(TapeTest, ChainedEquation) {
+  Tape tape;
+  auto a = tape.Leaf(2.0);
+  auto b = tape.Leaf(4.0);
+
+  auto z = ((pow(a, 2) + pow(b, 2)) / (a - b)) + (3 * a * b);
+  tape.Backward(z);
+
+  EXPECT_EQ(a.GetGrad(), 5);
+  EXPECT_EQ(b.GetGrad(), 7);
+  EXPECT_EQ(z.GetData(), 14.0);
+}
+
+// Z = (A + A + A)^2 + (3*A)
+TEST(TapeTest, SingleVariable) {
+  Tape tape;
+  auto a = tape.Leaf(2.0);
+  auto b = a + a + a;
+
+  auto z = pow(b, 2) + (3 * a);
+  tape.Backward(z);
+
+  EXPECT_EQ(a.GetGrad(), 39.0);
+  EXPECT_EQ(z.GetData(), 42);
+}
+
+TEST(TapeTest, Activations) {
+  Tape tape;
+  auto a = tape.Leaf(2.0);
+  auto b = tape.Leaf(-2.0);
+
+  auto z = sigmoid(a) + tanh(a) + relu(b) + log(a);
+  tape.Backward(z);
+
+  EXPECT_NEAR(a.GetGrad(), 0.1049935854035065 + 0.07065082485316443 + 0.5,
+              1e-9);
+  EXPECT_EQ(b.GetGrad(), 0);
+}
+
+TEST(TapeTest, ClearKeepsCapacity) {
+  Tape tape;
+  size_t capacity = 0;
+  for (int step = 0; step < 3; step++) {
+    tape.Clear();
+    EXPECT_EQ(tape.Size(), 0);
+    auto w = tape.Leaf(3.0);
+    auto loss = pow(w * 2.0 - 1.0, 2);
+    tape.Backward(loss);
+
+    EXPECT_EQ(loss.GetData(), 25.0);
+    EXPECT_EQ(w.GetGrad(), 20.0);
+    EXPECT_EQ(tape.Size(), 7);
+    if (step == 0) {
+      capacity = tape.Capacity();
+    } else {
+      // Replaying the same step reuses the storage of the first one.
+      EXPECT_EQ(tape.Capacity(), capacity);
+    }
+  }
+  EXPECT_GE(capacity, 7);
+
+  tape.Clear();
+  EXPECT_EQ(tape.Capacity(), capacity);
+}
+
+TEST(TapeTest, ReserveGrowsCapacity) {
+  Tape tape;
+  tape.Reserve(100);
+  EXPECT_GE(tape.Capacity(), 100);
+  EXPECT_EQ(tape.Size(), 0);
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,433 @@
+#include "tensor.h"
+#include "graph.h"
+#include "numeric.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+namespace {
+
+size_t NumElements(const Shape &shape) {
+  size_t size = 1;
+  for (auto dim : shape) {
+    size *= dim;
+  }
+  return size;
+}
+
+// The shape of the result of an elementwise operation on a and b.
+Shape BroadcastShape(const Shape &a, const Shape &b) {
+  auto rank = std::max(a.size(), b.size());
+  Shape shape(rank);
+  for (size_t i = 0; i < rank; i++) {
+    auto dim_a = i < rank - a.size() ? 1 : a[i - (rank - a.size())];
+    auto dim_b = i < rank - b.size() ? 1 : b[i - (rank - b.size())];
+    if (dim_a != dim_b && dim_a != 1 && dim_b != 1) {
+      throw std::invalid_argument("Tensor shapes cannot be broadcast");
+    }
+    shape[i] = dim_a == 1 ? dim_b : dim_a;
+  }
+  return shape;
+}
+
+// The strides of `shape` along the dimensions of the broadcast shape `out`,
+// zero where the dimension is broadcast.
+std::vector<size_t> BroadcastStrides(const Shape &shape, const Shape &out) {
+  std::vector<size_t> strides(out.size(), 0);
+  size_t stride = 1;
+  for (size_t i = shape.size(); i-- > 0;) {
+    strides[i + out.size() - shape.size()] = shape[i] == 1 ? 0 : stride;
+    stride *= shape[i];
+  }
+  return strides;
+}
+
+// Calls fn(i, ia, ib) for every element i of the broadcast shape `out`, where
+// ia and ib are the elements of a and b it is computed from. Equal shapes and
+// scalar operands run as plain loops the compiler can vectorize.
+template <typename Fn>
+void ForEachBroadcast(const Shape &out, const Shape &a, const Shape &b, Fn fn) {
+  auto size = NumElements(out);
+  auto size_a = NumElements(a);
+  auto size_b = NumElements(b);
+  if (size_a == size && size_b == size) {
+    for (size_t i = 0; i < size; i++) {
+      fn(i, i, i);
+    }
+    return;
+  }
+  if (size_a == 1 && size_b == size) {
+    for (size_t i = 0; i < size; i++) {
+      fn(i, 0, i);
+    }
+    return;
+  }
+  if (size_b == 1 && size_a == size) {
+    for (size_t i = 0; i < size; i++) {
+      fn(i, i, 0);
+    }
+    return;
+  }
+
+  auto strides_a = BroadcastStrides(a, out);
+  auto strides_b = BroadcastStrides(b, out);
+  std::vector<size_t> index(out.size(), 0);
+  size_t ia = 0;
+  size_t ib = 0;
+  for (size_t i = 0; i < size; i++) {
+    fn(i, ia, ib);
+    for (size_t dim = out.size(); dim-- > 0;) {
+      index[dim]++;
+      ia += strides_a[dim];
+      ib += strides_b[dim];
+      if (index[dim] < out[dim]) {
+        break;
+      }
+      ia -= strides_a[dim] * out[dim];
+      ib -= strides_b[dim] * out[dim];
+      index[dim] = 0;
+    }
+  }
+}
+
+} // namespace
+
+struct Tensor::Kernels {
+  // Creates the elementwise result of a unary function. `forward(x)` gives
+  // the value and `derivative(x, y)` the local derivative from the input and
+  // output values.
+  template <typename Forward, typename Derivative>
+  static std::shared_ptr<Tensor> Unary(const std::shared_ptr<Tensor> &x,
+                                       Forward forward, Derivative derivative) {
+    auto result = Tensor::CreateTensor(x->shape_, 0.0);
+    auto size = x->Size();
+    const auto *in = x->data_.data();
+    auto *out = result->data_.data();
+    for (size_t i = 0; i < size; i++) {
+      out[i] = forward(in[i]);
+    }
+
+    result->children_ = {x};
+    result->backward_fn_ = [x = x.get(), result = result.get(), derivative]() {
+      auto size = x->Size();
+      const auto *in = x->data_.data();
+      const auto *out = result->data_.data();
+      const auto *grad_out = result->grad_.data();
+      auto *grad_in = x->grad_.data();
+      for (size_t i = 0; i < size; i++) {
+        grad_in[i] += grad_out[i] * derivative(in[i], out[i]);
+      }
+    };
+    return result;
+  }
+
+  // Creates the broadcast result of a binary function. `forward(x, y)` gives
+  // the value, and `derivative_a(x, y)` and `derivative_b(x, y)` the local
+  // derivatives with respect to each operand.
+  template <typename Forward, typename DerivativeA, typename DerivativeB>
+  static std::shared_ptr<Tensor>
+  Binary(const std::shared_ptr<Tensor> &a, const std::shared_ptr<Tensor> &b,
+         Forward forward, DerivativeA derivative_a, DerivativeB derivative_b) {
+    auto result =
+        Tensor::CreateTensor(BroadcastShape(a->shape_, b->shape_), 0.0);
+    const auto *in_a = a->data_.data();
+    const auto *in_b = b->data_.data();
+    auto *out = result->data_.data();
+    ForEachBroadcast(result->shape_, a->shape_, b->shape_,
+                     [&](size_t i, size_t ia, size_t ib) {
+                       out[i] = forward(in_a[ia], in_b[ib]);
+                     });
+
+    result->children_ = {a, b};
+    result->backward_fn_ = [a = a.get(), b = b.get(), result = result.get(),
+                            derivative_a, derivative_b]() {
+      const auto *in_a = a->data_.data();
+      const auto *in_b = b->data_.data();
+      const auto *grad_out = result->grad_.data();
+      auto *grad_a = a->grad_.data();
+      auto *grad_b = b->grad_.data();
+      ForEachBroadcast(result->shape_, a->shape_, b->shape_,
+                       [&](size_t i, size_t ia, size_t ib) {
+                         grad_a[ia] +=
+                             grad_out[i] * derivative_a(in_a[ia], in_b[ib]);
+                         grad_b[ib] +=
+                             grad_out[i] * derivative_b(in_a[ia], in_b[ib]);
+                       });
+    };
+    return result;
+  }
+};
+
+Tensor::Tensor(Shape shape, std::vector<double> data) {
+  if (data.size() != NumElements(shape)) {
+    throw std::invalid_argument("Tensor data does not match its shape");
+  }
+  this->shape_ = std::move(shape);
+  this->data_ = std::move(data);
+  this->grad_.assign(this->data_.size(), 0.0);
+}
+
+std::shared_ptr<Tensor> Tensor::CreateTensor(Shape shape,
+                                             std::vector<double> data) {
+  return std::make_shared<Tensor>(std::move(shape), std::move(data));
+}
+
+std::shared_ptr<Tensor> Tensor::CreateTensor(Shape shape, double value) {
+  auto size = NumElements(shape);
+  return std::make_shared<Tensor>(std::move(shape),
+                                  std::vector<double>(size, value));
+}
+
+void Tensor::SetData(std::vector<double> data) {
+  if (data.size() != data_.size()) {
+    throw std::invalid_argument("Tensor data does not match its shape");
+  }
+  data_ = std::move(data);
+}
+
+void Tensor::ZeroGrad() { std::fill(grad_.begin(), grad_.end(), 0.0); }
+
+void Tensor::Backward() {
+  std::fill(grad_.begin(), grad_.end(), 1.0);
+  // Children are only set when a tensor is created, so the order stays valid.
+  if (topological_order_.empty()) {
+    internal::TopologicalSort(this, &topological_order_);
+  }
+  for (auto it = topological_order_.rbegin(); it != topological_order_.rend();
+       ++it) {
+    auto *node = *it;
+    if (node->backward_fn_ != nullptr) {
+      node->backward_fn_();
+    }
+  }
+}
+
+std::shared_ptr<Tensor> operator+(const std::shared_ptr<Tensor> &a,
+                                  const std::shared_ptr<Tensor> &b) {
+  return Tensor::Kernels::Binary(
+      a, b, [](double x, double y) { return x + y; },
+      [](double, double) { return 1.0; }, [](double, double) { return 1.0; });
+}
+
+std::shared_ptr<Tensor> operator+(const std::shared_ptr<Tensor> &a,
+                                  double b) {
+  return Tensor::Kernels::Unary(
+      a, [b](double x) { return x + b; },
+      [](double, double) { return 1.0; });
+}
+
+std::shared_ptr<Tensor> operator+(double a,
+                                  const std::shared_ptr<Tensor> &b) {
+  return b + a;
+}
+
+std::shared_ptr<Tensor> operator-(const std::shared_ptr<Tensor> &a,
+                                  const std::shared_ptr<Tensor> &b) {
+  return Tensor::Kernels::Binary(
+      a, b, [](double x, double y) { return x - y; },
+      [](double, double) { return 1.0; }, [](double, double) { return -1.0; });
+}
+
+std::shared_ptr<Tensor> operator-(const std::shared_ptr<Tensor> &a,
+                                  double b) {
+  return a + (-b);
+}
+
+std::shared_ptr<Tensor> operator-(double a,
+                                  const std::shared_ptr<Tensor> &b) {
+  return Tensor::Kernels::Unary(
+      b, [a](double x) { return a - x; },
+      [](double, double) { return -1.0; });
+}
+
+std::shared_ptr<Tensor> operator*(const std::shared_ptr<Tensor> &a,
+                                  const std::shared_ptr<Tensor> &b) {
+  return Tensor::Kernels::Binary(
+      a, b, [](double x, double y) { return x * y; },
+      [](double, double y) { return y; }, [](double x, double) { return x; });
+}
+
+std::shared_ptr<Tensor> operator*(const std::shared_ptr<Tensor> &a,
+                                  double b) {
+  return Tensor::Kernels::Unary(
+      a, [b](double x) { return x * b; }, [b](double, double) { return b; });
+}
+
+std::shared_ptr<Tensor> operator*(double a,
+                                  const std::shared_ptr<Tensor> &b) {
+  return b * a;
+}
+
+std::shared_ptr<Tensor> operator/(const std::shared_ptr<Tensor> &a,
+                                  const std::shared_ptr<Tensor> &b) {
+  return Tensor::Kernels::Binary(
+      a, b, [](double x, double y) { return x / y; },
+      [](double, double y) { return 1.0 / y; },
+      [](double x, double y) { return -x / (y * y); });
+}
+
+std::shared_ptr<Tensor> operator/(const std::shared_ptr<Tensor> &a,
+                                  double b) {
+  return a * (1.0 / b);
+}
+
+std::shared_ptr<Tensor> pow(const std::shared_ptr<Tensor> &base,
+                            double exponent) {
+  return Tensor::Kernels::Unary(
+      base, [exponent](double x) { return std::pow(x, exponent); },
+      [exponent](double x, double) {
+        return exponent * std::pow(x, exponent - 1);
+      });
+}
+
+std::shared_ptr<Tensor> log(const std::shared_ptr<Tensor> &x) {
+  return Tensor::Kernels::Unary(
+      x, [](double value) { return std::log(value); },
+      [](double value, double) { return 1.0 / value; });
+}
+
+std::shared_ptr<Tensor> sigmoid(const std::shared_ptr<Tensor> &x) {
+  return Tensor::Kernels::Unary(
+      x,
+      [](double value) { return internal::StableSigmoid(value); },
+      [](double, double output) { return output * (1.0 - output); });
+}
+
+std::shared_ptr<Tensor> tanh(const std::shared_ptr<Tensor> &x) {
+  return Tensor::Kernels::Unary(
+      x, [](double value) { return std::tanh(value); },
+      [](double, double output) { return 1.0 - output * output; });
+}
+
+std::shared_ptr<Tensor> relu(const std::shared_ptr<Tensor> &x) {
+  return Tensor::Kernels::Unary(
+      x, [](double value) { return value > 0 ? value : 0.0; },
+      [](double value, double) { return value > 0 ? 1.0 : 0.0; });
+}
+
+std::shared_ptr<Tensor> Sum(const std::shared_ptr<Tensor> &x) {
+  double total = 0.0;
+  for (auto value : x->data_) {
+    total += value;
+  }
+  auto result = Tensor::CreateTensor(Shape{}, total);
+
+  result->children_ = {x};
+  result->backward_fn_ = [x = x.get(), result = result.get()]() {
+    auto grad = result->grad_[0];
+    for (auto &grad_in : x->grad_) {
+      grad_in += grad;
+    }
+  };
+  return result;
+}
+
+std::shared_ptr<Tensor> Sum(const std::shared_ptr<Tensor> &x, size_t axis) {
+  if (axis >= x->shape_.size()) {
+    throw std::invalid_argument("Sum axis is out of range");
+  }
+  // View x as [outer, extent, inner] and reduce the middle dimension.
+  auto extent = x->shape_[axis];
+  size_t outer = 1;
+  for (size_t i = 0; i < axis; i++) {
+    outer *= x->shape_[i];
+  }
+  size_t inner = 1;
+  for (size_t i = axis + 1; i < x->shape_.size(); i++) {
+    inner *= x->shape_[i];
+  }
+  auto shape = x->shape_;
+  shape.erase(shape.begin() + axis);
+  auto result = Tensor::CreateTensor(std::move(shape), 0.0);
+
+  const auto *in = x->data_.data();
+  auto *out = result->data_.data();
+  for (size_t o = 0; o < outer; o++) {
+    for (size_t e = 0; e < extent; e++) {
+      const auto *row = in + (o * extent + e) * inner;
+      for (size_t i = 0; i < inner; i++) {
+        out[o * inner + i] += row[i];
+      }
+    }
+  }
+
+  result->children_ = {x};
+  result->backward_fn_ = [x = x.get(), result = result.get(), outer, extent,
+                          inner]() {
+    const auto *grad_out = result->grad_.data();
+    auto *grad_in = x->grad_.data();
+    for (size_t o = 0; o < outer; o++) {
+      for (size_t e = 0; e < extent; e++) {
+        auto *row = grad_in + (o * extent + e) * inner;
+        for (size_t i = 0; i < inner; i++) {
+          row[i] += grad_out[o * inner + i];
+        }
+      }
+    }
+  };
+  return result;
+}
+
+std::shared_ptr<Tensor> Mean(const std::shared_ptr<Tensor> &x) {
+  return Sum(x) * (1.0 / x->Size());
+}
+
+std::shared_ptr<Tensor> MatMul(const std::shared_ptr<Tensor> &a,
+                               const std::shared_ptr<Tensor> &b) {
+  if (a->shape_.size() != 2 || b->shape_.size() != 2 ||
+      a->shape_[1] != b->shape_[0]) {
+    throw std::invalid_argument("MatMul expects [m, k] and [k, n] tensors");
+  }
+  auto m = a->shape_[0];
+  auto k = a->shape_[1];
+  auto n = b->shape_[1];
+  auto result = Tensor::CreateTensor(Shape{m, n}, 0.0);
+
+  // The innermost loops run along contiguous rows so that they vectorize.
+  const auto *in_a = a->data_.data();
+  const auto *in_b = b->data_.data();
+  auto *out = result->data_.data();
+  for (size_t i = 0; i < m; i++) {
+    for (size_t p = 0; p < k; p++) {
+      auto scale = in_a[i * k + p];
+      for (size_t j = 0; j < n; j++) {
+        out[i * n + j] += scale * in_b[p * n + j];
+      }
+    }
+  }
+
+  result->children_ = {a, b};
+  result->backward_fn_ = [a = a.get(), b = b.get(), result = result.get(), m, k,
+                          n]() {
+    const auto *in_a = a->data_.data();
+    const auto *in_b = b->data_.data();
+    const auto *grad_out = result->grad_.data();
+    auto *grad_a = a->grad_.data();
+    auto *grad_b = b->grad_.data();
+    for (size_t i = 0; i < m; i++) {
+      for (size_t p = 0; p < k; p++) {
+        // dA = dC * B^T and dB = A^T * dC, sharing the pass over dC's row.
+        double dot = 0.0;
+        auto scale = in_a[i * k + p];
+        for (size_t j = 0; j < n; j++) {
+          dot += grad_out[i * n + j] * in_b[p * n + j];
+          grad_b[p * n + j] += scale * grad_out[i * n + j];
+        }
+        grad_a[i * k + p] += dot;
+      }
+    }
+  };
+  return result;
+}
+
+} // namespace micrograd
+} // namespace apexkid
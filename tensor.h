@@ -0,0 +1,186 @@
+#ifndef TENSOR_H
+#define TENSOR_H
+
+#include "graph.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+/// The dimensions of a tensor, outermost first. An empty shape is a scalar.
+using Shape = std::vector<size_t>;
+
+/**
+ * @class Tensor
+ * @brief A node holding a contiguous N-dimensional array in a computational
+ * graph for automatic differentiation.
+ *
+ * Tensor is the array counterpart of GradNode: operations build the same kind
+ * of graph and Backward() uses the same topological sort, but every node
+ * holds a whole row-major buffer of values and gradients, and its forward and
+ * backward passes are flat loops over those buffers. Elementwise operations
+ * broadcast following NumPy rules.
+ */
+class Tensor {
+public:
+  /**
+   * @brief Constructs a Tensor with a shape and row-major data.
+   * @param shape The dimensions of the tensor.
+   * @param data The values of the tensor, one per element of the shape.
+   */
+  Tensor(Shape shape, std::vector<double> data);
+
+  /**
+   * @brief Creates a Tensor with a shape and row-major data.
+   * @param shape The dimensions of the tensor.
+   * @param data The values of the tensor, one per element of the shape.
+   * @return A shared pointer to the created Tensor.
+   */
+  static std::shared_ptr<Tensor> CreateTensor(Shape shape,
+                                              std::vector<double> data);
+
+  /**
+   * @brief Creates a Tensor with every element set to the same value.
+   * @param shape The dimensions of the tensor.
+   * @param value The value of every element.
+   * @return A shared pointer to the created Tensor.
+   */
+  static std::shared_ptr<Tensor> CreateTensor(Shape shape, double value);
+
+  /**
+   * @brief Performs a backward pass to compute gradients.
+   *
+   * The gradient of every element of this tensor is seeded with one, which
+   * for a non-scalar tensor differentiates the sum of its elements.
+   */
+  void Backward();
+
+  /**
+   * @brief Gets the dimensions of the tensor.
+   * @return The shape.
+   */
+  const Shape &GetShape() const { return shape_; }
+
+  /**
+   * @brief Gets the number of elements of the tensor.
+   * @return The number of elements.
+   */
+  size_t Size() const { return data_.size(); }
+
+  /**
+   * @brief Gets the row-major values of the tensor.
+   * @return The values.
+   */
+  const std::vector<double> &GetData() const { return data_; }
+
+  /**
+   * @brief Gets the row-major gradients of the tensor.
+   * @return The gradients.
+   */
+  const std::vector<double> &GetGrad() const { return grad_; }
+
+  /**
+   * @brief Sets the values of the tensor in place.
+   * @param data The new values, one per element.
+   */
+  void SetData(std::vector<double> data);
+
+  /**
+   * @brief Resets every gradient of the tensor to zero.
+   */
+  void ZeroGrad();
+
+  // Elementwise arithmetic with broadcasting
+
+  /// Addition
+  friend std::shared_ptr<Tensor> operator+(const std::shared_ptr<Tensor> &a,
+                                           const std::shared_ptr<Tensor> &b);
+  friend std::shared_ptr<Tensor> operator+(const std::shared_ptr<Tensor> &a,
+                                           double b);
+  friend std::shared_ptr<Tensor> operator+(double a,
+                                           const std::shared_ptr<Tensor> &b);
+
+  /// Subtraction
+  friend std::shared_ptr<Tensor> operator-(const std::shared_ptr<Tensor> &a,
+                                           const std::shared_ptr<Tensor> &b);
+  friend std::shared_ptr<Tensor> operator-(const std::shared_ptr<Tensor> &a,
+                                           double b);
+  friend std::shared_ptr<Tensor> operator-(double a,
+                                           const std::shared_ptr<Tensor> &b);
+
+  /// Multiplication
+  friend std::shared_ptr<Tensor> operator*(const std::shared_ptr<Tensor> &a,
+                                           const std::shared_ptr<Tensor> &b);
+  friend std::shared_ptr<Tensor> operator*(const std::shared_ptr<Tensor> &a,
+                                           double b);
+  friend std::shared_ptr<Tensor> operator*(double a,
+                                           const std::shared_ptr<Tensor> &b);
+
+  /// Division
+  friend std::shared_ptr<Tensor> operator/(const std::shared_ptr<Tensor> &a,
+                                           const std::shared_ptr<Tensor> &b);
+  friend std::shared_ptr<Tensor> operator/(const std::shared_ptr<Tensor> &a,
+                                           double b);
+
+  // Elementwise functions
+
+  /// Power
+  friend std::shared_ptr<Tensor> pow(const std::shared_ptr<Tensor> &base,
+                                     double exponent);
+
+  /// Log
+  friend std::shared_ptr<Tensor> log(const std::shared_ptr<Tensor> &x);
+
+  /// Sigmoid
+  friend std::shared_ptr<Tensor> sigmoid(const std::shared_ptr<Tensor> &x);
+
+  /// Tanh
+  friend std::shared_ptr<Tensor> tanh(const std::shared_ptr<Tensor> &x);
+
+  /// ReLU
+  friend std::shared_ptr<Tensor> relu(const std::shared_ptr<Tensor> &x);
+
+  // Reductions and linear algebra
+
+  /// Sum of all elements, as a scalar tensor.
+  friend std::shared_ptr<Tensor> Sum(const std::shared_ptr<Tensor> &x);
+
+  /// Sum along one axis, which is removed from the shape.
+  friend std::shared_ptr<Tensor> Sum(const std::shared_ptr<Tensor> &x,
+                                     size_t axis);
+
+  /// Mean of all elements, as a scalar tensor.
+  friend std::shared_ptr<Tensor> Mean(const std::shared_ptr<Tensor> &x);
+
+  /// Matrix product of a [m, k] and a [k, n] tensor.
+  friend std::shared_ptr<Tensor> MatMul(const std::shared_ptr<Tensor> &a,
+                                        const std::shared_ptr<Tensor> &b);
+
+private:
+  template <typename Node>
+  friend void internal::TopologicalSort(Node *root, std::vector<Node *> *order);
+
+  /// Loops shared by the elementwise operations, defined in tensor.cc.
+  struct Kernels;
+
+  /// Private members
+  std::vector<std::shared_ptr<Tensor>> children_; // Child nodes.
+  // Backward function to compute gradients. It only captures raw pointers, as
+  // the node keeps its children alive and must not keep itself alive.
+  std::function<void()> backward_fn_;
+  Shape shape_;               // The dimensions of the tensor.
+  std::vector<double> data_; // The row-major values.
+  std::vector<double> grad_; // The row-major gradients.
+  uint64_t visit_epoch_ = 0; // Epoch of the last sort that visited the node.
+  std::vector<Tensor *> topological_order_; // Cached sort order.
+};
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // TENSOR_H
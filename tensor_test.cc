@@ -0,0 +1,131 @@
+#include "tensor.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+TEST(TensorTest, ElementwiseSum) {
+  auto a = Tensor::CreateTensor({2}, {1.0, 2.0});
+  auto b = Tensor::CreateTensor({2}, {3.0, 4.0});
+
+  auto z = Sum(a * b + a);
+  z->Backward();
+
+  EXPECT_EQ(z->GetData(), (std::vector<double>{14.0}));
+  EXPECT_EQ(a->GetGrad(), (std::vector<double>{4.0, 5.0}));
+  EXPECT_EQ(b->GetGrad(), (std::vector<double>{1.0, 2.0}));
+}
+
+// A [2, 3] matrix plus a [3] row vector broadcasts over the rows.
+TEST(TensorTest, BroadcastRow) {
+  auto x = Tensor::CreateTensor({2, 3}, {1, 2, 3, 4, 5, 6});
+  auto bias = Tensor::CreateTensor({3}, {10, 20, 30});
+
+  auto y = x + bias;
+  auto z = Sum(y * y);
+  z->Backward();
+
+  EXPECT_EQ(y->GetShape(), (Shape{2, 3}));
+  EXPECT_EQ(y->GetData(), (std::vector<double>{11, 22, 33, 14, 25, 36}));
+  EXPECT_EQ(bias->GetGrad(), (std::vector<double>{50, 94, 138}));
+  EXPECT_EQ(x->GetGrad(), (std::vector<double>{22, 44, 66, 28, 50, 72}));
+}
+
+// A [2, 1] column times a [3] row broadcasts to [2, 3].
+TEST(TensorTest, BroadcastOuter) {
+  auto col = Tensor::CreateTensor({2, 1}, {1, 2});
+  auto row = Tensor::CreateTensor({3}, {1, 10, 100});
+
+  auto z = col * row;
+  z->Backward();
+
+  EXPECT_EQ(z->GetData(), (std::vector<double>{1, 10, 100, 2, 20, 200}));
+  EXPECT_EQ(col->GetGrad(), (std::vector<double>{111, 111}));
+  EXPECT_EQ(row->GetGrad(), (std::vector<double>{3, 3, 3}));
+}
+
+TEST(TensorTest, IncompatibleShapes) {
+  auto a = Tensor::CreateTensor({2}, 1.0);
+  auto b = Tensor::CreateTensor({3}, 1.0);
+
+  EXPECT_THROW(a + b, std::invalid_argument);
+  EXPECT_THROW(MatMul(a, b), std::invalid_argument);
+}
+
+TEST(TensorTest, MatMul) {
+  auto a = Tensor::CreateTensor({2, 3}, {1, 2, 3, 4, 5, 6});
+  auto b = Tensor::CreateTensor({3, 2}, {7, 8, 9, 10, 11, 12});
+
+  auto c = MatMul(a, b);
+  auto z = Sum(c * c);
+  z->Backward();
+
+  EXPECT_EQ(c->GetShape(), (Shape{2, 2}));
+  EXPECT_EQ(c->GetData(), (std::vector<double>{58, 64, 139, 154}));
+  // dZ/dC = 2C, dA = dC * B^T, dB = A^T * dC.
+  EXPECT_EQ(a->GetGrad(),
+            (std::vector<double>{1836, 2324, 2812, 4410, 5582, 6754}));
+  EXPECT_EQ(b->GetGrad(),
+            (std::vector<double>{1228, 1360, 1622, 1796, 2016, 2232}));
+}
+
+TEST(TensorTest, SumAxis) {
+  auto x = Tensor::CreateTensor({2, 3}, {1, 2, 3, 4, 5, 6});
+
+  auto rows = Sum(x, 1);
+  auto cols = Sum(x, 0);
+  auto z = Sum(rows * 2.0) + Sum(cols);
+  z->Backward();
+
+  EXPECT_EQ(rows->GetData(), (std::vector<double>{6, 15}));
+  EXPECT_EQ(cols->GetData(), (std::vector<double>{5, 7, 9}));
+  EXPECT_EQ(x->GetGrad(), (std::vector<double>(6, 3.0)));
+}
+
+TEST(TensorTest, Activations) {
+  auto x = Tensor::CreateTensor({3}, {2.0, -2.0, -1000.0});
+
+  auto z = Sum(sigmoid(x) + tanh(x) + relu(x));
+  z->Backward();
+
+  EXPECT_NEAR(x->GetGrad()[0], 0.1049935854035065 + 0.07065082485316443 + 1,
+              1e-9);
+  EXPECT_NEAR(x->GetGrad()[1], 0.1049935854035065 + 0.07065082485316443,
+              1e-9);
+  EXPECT_EQ(x->GetGrad()[2], 0.0);
+}
+
+// Fits y = 2*x1 - 3*x2 + 5 with full-batch gradient descent.
+TEST(TensorTest, LinearRegression) {
+  auto x = Tensor::CreateTensor({4, 2}, {1, 0, 0, 1, 1, 1, 2, 1});
+  auto y = Tensor::CreateTensor({4, 1}, {7, 2, 4, 6});
+  auto w = Tensor::CreateTensor({2, 1}, 0.0);
+  auto b = Tensor::CreateTensor({1}, 0.0);
+
+  for (int step = 0; step < 2000; step++) {
+    w->ZeroGrad();
+    b->ZeroGrad();
+    auto loss = Mean(pow(MatMul(x, w) + b - y, 2.0));
+    loss->Backward();
+
+    auto w_data = w->GetData();
+    for (size_t i = 0; i < w_data.size(); i++) {
+      w_data[i] -= 0.1 * w->GetGrad()[i];
+    }
+    w->SetData(w_data);
+    b->SetData({b->GetData()[0] - 0.1 * b->GetGrad()[0]});
+  }
+
+  EXPECT_NEAR(w->GetData()[0], 2.0, 1e-6);
+  EXPECT_NEAR(w->GetData()[1], -3.0, 1e-6);
+  EXPECT_NEAR(b->GetData()[0], 5.0, 1e-6);
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
@@ -0,0 +1,119 @@
+#include "thread_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+ThreadPool::ThreadPool(size_t num_threads) {
+  for (size_t i = 1; i < num_threads; i++) {
+    workers_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_ready_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(size_t count,
+                             const std::function<void(size_t)> &fn) {
+  if (workers_.empty() || count <= 1) {
+    for (size_t i = 0; i < count; i++) {
+      fn(i);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fn_ != nullptr) {
+      throw std::logic_error("ThreadPool::ParallelFor is already running");
+    }
+    fn_ = &fn;
+    count_ = count;
+    next_.store(0, std::memory_order_relaxed);
+    generation_++;
+  }
+  work_ready_.notify_all();
+  RunIterations(fn, count);
+
+  // Every iteration has been handed out. Wait for the workers still running
+  // one.
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_done_.wait(lock, [this]() { return active_ == 0; });
+  fn_ = nullptr;
+  if (error_ != nullptr) {
+    auto error = std::move(error_);
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+void ThreadPool::RunIterations(const std::function<void(size_t)> &fn,
+                               size_t count) {
+  while (true) {
+    auto index = next_.fetch_add(1, std::memory_order_relaxed);
+    if (index >= count) {
+      return;
+    }
+    try {
+      fn(index);
+    } catch (...) {
+      // Keep the first exception and drop the iterations not handed out yet.
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (error_ == nullptr) {
+        error_ = std::current_exception();
+      }
+      next_.store(count, std::memory_order_relaxed);
+      return;
+    }
+  }
+}
+
+void ThreadPool::WorkerLoop() {
+  size_t seen_generation = 0;
+  while (true) {
+    const std::function<void(size_t)> *fn;
+    size_t count;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_ready_.wait(lock, [this, seen_generation]() {
+        return stopping_ || generation_ != seen_generation;
+      });
+      if (stopping_) {
+        return;
+      }
+      seen_generation = generation_;
+      if (fn_ == nullptr) {
+        continue; // The loop finished before this worker woke up.
+      }
+      fn = fn_;
+      count = count_;
+      active_++;
+    }
+    RunIterations(*fn, count);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--active_ == 0) {
+        work_done_.notify_all();
+      }
+    }
+  }
+}
+
+} // namespace micrograd
+} // namespace apexkid
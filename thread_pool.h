@@ -0,0 +1,91 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+/**
+ * @class ThreadPool
+ * @brief A fixed set of worker threads running parallel loops.
+ *
+ * ParallelFor() hands out loop indices dynamically, so threads that finish
+ * early keep taking work from the same loop. Indices are taken with an
+ * atomic increment; the mutex is only locked to start, join and finish a
+ * loop. The calling thread takes part too, so a pool of one thread runs
+ * loops inline without any worker.
+ */
+class ThreadPool {
+public:
+  /**
+   * @brief Constructs a pool.
+   * @param num_threads The number of threads running a loop, including the
+   * calling thread.
+   */
+  explicit ThreadPool(size_t num_threads);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * @brief Runs fn(i) for every i in [0, count) and waits for completion.
+   *
+   * If fn throws, the iterations not started yet are skipped and the first
+   * exception is rethrown once the running ones have finished.
+   *
+   * A pool runs one loop at a time. Calling ParallelFor from a loop body, or
+   * from another thread while a loop runs, throws std::logic_error; loops of
+   * at most one iteration, and all loops of a one-thread pool, run inline and
+   * are not checked.
+   * @param count The number of loop iterations.
+   * @param fn The loop body. Must be safe to call concurrently.
+   */
+  void ParallelFor(size_t count, const std::function<void(size_t)> &fn);
+
+  /**
+   * @brief Gets the number of threads running a loop.
+   * @return The number of threads, including the calling thread.
+   */
+  size_t NumThreads() const { return workers_.size() + 1; }
+
+private:
+  /**
+   * @brief Takes and runs iterations of the current loop until none is left.
+   * @param fn The loop body.
+   * @param count The number of loop iterations.
+   */
+  void RunIterations(const std::function<void(size_t)> &fn, size_t count);
+
+  /**
+   * @brief The body of each worker thread.
+   */
+  void WorkerLoop();
+
+  /// Private members
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_ready_;  // Signalled when a loop starts.
+  std::condition_variable work_done_;   // Signalled when a loop finishes.
+  const std::function<void(size_t)> *fn_ = nullptr; // The current loop body.
+  size_t count_ = 0;       // Number of iterations of the current loop.
+  std::atomic<size_t> next_{0}; // Next iteration to hand out.
+  size_t active_ = 0;      // Workers running the current loop.
+  size_t generation_ = 0;  // Incremented for every loop.
+  std::exception_ptr error_; // The first exception thrown by the loop body.
+  bool stopping_ = false;  // Set when the pool is destroyed.
+};
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,69 @@
+#include "thread_pool.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+TEST(ThreadPoolTest, RunsEveryIterationOnce) {
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> counts(1000);
+
+  for (int loop = 0; loop < 10; loop++) {
+    pool.ParallelFor(counts.size(), [&](size_t i) { counts[i]++; });
+  }
+
+  for (auto &count : counts) {
+    EXPECT_EQ(count.load(), 10);
+  }
+}
+
+TEST(ThreadPoolTest, SingleThreadRunsInline) {
+  ThreadPool pool(1);
+  std::vector<size_t> order;
+
+  pool.ParallelFor(5, [&](size_t i) { order.push_back(i); });
+
+  EXPECT_EQ(pool.NumThreads(), 1);
+  EXPECT_EQ(order, (std::vector<size_t>{0, 1, 2, 3, 4}));
+}
+
+TEST(ThreadPoolTest, RethrowsExceptionAfterLoopFinishes) {
+  ThreadPool pool(4);
+  std::atomic<int> running{0};
+
+  EXPECT_THROW(pool.ParallelFor(1000,
+                                [&](size_t i) {
+                                  running++;
+                                  if (i % 100 == 7) {
+                                    running--;
+                                    throw std::runtime_error("failed");
+                                  }
+                                  running--;
+                                }),
+               std::runtime_error);
+  EXPECT_EQ(running.load(), 0);
+
+  // The pool runs later loops as usual.
+  std::vector<std::atomic<int>> counts(100);
+  pool.ParallelFor(counts.size(), [&](size_t i) { counts[i]++; });
+  for (auto &count : counts) {
+    EXPECT_EQ(count.load(), 1);
+  }
+}
+
+TEST(ThreadPoolTest, RejectsNestedLoops) {
+  ThreadPool pool(2);
+
+  EXPECT_THROW(pool.ParallelFor(
+                   4, [&](size_t) { pool.ParallelFor(4, [](size_t) {}); }),
+               std::logic_error);
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid
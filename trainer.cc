@@ -0,0 +1,63 @@
+#include "trainer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+BatchTrainer::BatchTrainer(ParameterSet *params, size_t num_threads)
+    : params_(params), pool_(std::max<size_t>(num_threads, 1)) {
+  for (size_t i = 0; i < pool_.NumThreads(); i++) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+double BatchTrainer::ComputeGradients(size_t begin, size_t end,
+                                      const SampleLoss &loss) {
+  params_->GatherData(&values_);
+  auto num_params = values_.size();
+  auto num_shards = shards_.size();
+  auto num_samples = end > begin ? end - begin : 0;
+
+  pool_.ParallelFor(num_shards, [&](size_t s) {
+    auto &shard = *shards_[s];
+    shard.grad.assign(num_params, 0.0);
+    shard.loss = 0.0;
+    auto shard_begin = begin + num_samples * s / num_shards;
+    auto shard_end = begin + num_samples * (s + 1) / num_shards;
+    for (auto sample = shard_begin; sample < shard_end; sample++) {
+      shard.tape.Clear();
+      shard.params.clear();
+      for (auto value : values_) {
+        shard.params.push_back(shard.tape.Leaf(value));
+      }
+      auto sample_loss = loss(shard.tape, shard.params, sample);
+      shard.tape.Backward(sample_loss);
+      shard.loss += sample_loss.GetData();
+      for (size_t p = 0; p < num_params; p++) {
+        shard.grad[p] += shard.params[p].GetGrad();
+      }
+    }
+  });
+
+  // Pairwise tree reduction into shard 0, in an order fixed by the shard
+  // count.
+  for (size_t stride = 1; stride < num_shards; stride *= 2) {
+    for (size_t s = 0; s + stride < num_shards; s += 2 * stride) {
+      auto &target = *shards_[s];
+      const auto &source = *shards_[s + stride];
+      for (size_t p = 0; p < num_params; p++) {
+        target.grad[p] += source.grad[p];
+      }
+      target.loss += source.loss;
+    }
+  }
+  params_->AccumulateGrad(shards_[0]->grad);
+  return shards_[0]->loss;
+}
+
+} // namespace micrograd
+} // namespace apexkid
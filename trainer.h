@@ -0,0 +1,75 @@
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include "parameter.h"
+#include "tape.h"
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+
+/**
+ * @brief Records the loss of one training sample on a tape.
+ *
+ * The tape already holds one leaf per parameter, passed in `params` in
+ * ParameterSet order. The function must only touch the given tape.
+ */
+using SampleLoss = std::function<Var(Tape &tape, const std::vector<Var> &params,
+                                     size_t sample)>;
+
+/**
+ * @class BatchTrainer
+ * @brief Computes mini-batch gradients of a ParameterSet on several threads.
+ *
+ * A batch is split into one contiguous shard per thread. Each shard records
+ * its samples on its own Tape, so threads never share graph state, and sums
+ * the parameter gradients in its own buffer. The shard buffers are then
+ * combined by a pairwise tree reduction in a fixed order and added to the
+ * parameters' gradients, so results only depend on the number of threads and
+ * not on scheduling.
+ */
+class BatchTrainer {
+public:
+  /**
+   * @brief Constructs a trainer.
+   * @param params The parameters to differentiate. Must outlive the trainer.
+   * @param num_threads The number of threads, and so of shards per batch.
+   */
+  BatchTrainer(ParameterSet *params, size_t num_threads);
+
+  /**
+   * @brief Accumulates the gradient of the summed loss over a batch.
+   *
+   * The gradients are added to the parameters' current gradients; call
+   * ParameterSet::ZeroGrad() or Optimizer::ZeroGrad() between steps.
+   * @param begin The first sample of the batch.
+   * @param end One past the last sample of the batch.
+   * @param loss Records the loss of a sample.
+   * @return The summed loss over the batch.
+   */
+  double ComputeGradients(size_t begin, size_t end, const SampleLoss &loss);
+
+private:
+  /// The recording state of one shard, reused across batches.
+  struct Shard {
+    Tape tape;
+    std::vector<Var> params;
+    std::vector<double> grad;
+    double loss = 0.0;
+  };
+
+  ParameterSet *params_;       // The parameters to differentiate.
+  ThreadPool pool_;            // Runs one shard per thread.
+  std::vector<std::unique_ptr<Shard>> shards_; // One shard per thread.
+  std::vector<double> values_; // Flat copy of the parameter values.
+};
+
+} // namespace micrograd
+} // namespace apexkid
+
+#endif // TRAINER_H
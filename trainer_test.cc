@@ -0,0 +1,98 @@
+#include "trainer.h"
+#include "gtest/gtest.h"
+
+#include "micrograd.h"
+#include "optimizer.h"
+
+#include <vector>
+
+namespace apexkid {
+namespace micrograd {
+namespace {
+
+// The data set of nn_linear_regression_demo.
+const std::vector<double> kX1 = {4, 2, 3, 1, 2, 8, 1, 9, 6, 1};
+const std::vector<double> kX2 = {3, 1, 4, 4, 2, 1, 2, 3, 2, 2};
+const std::vector<double> kX3 = {7, 7, 9, 3, 1, 6, 3, 5, 7, 5};
+const std::vector<double> kY = {33, 34, 35, 8.2, 7, 41.4, 13, 33, 39, 26};
+
+Var SquaredError(Tape &, const std::vector<Var> &params, size_t i) {
+  auto pred = params[0] * kX1[i] + params[1] * kX2[i] + params[2] * kX3[i] +
+              params[3];
+  return pow(pred - kY[i], 2.0);
+}
+
+ParameterSet CreateParameters() {
+  ParameterSet params;
+  params.Create(0.1, "w1");
+  params.Create(0.7, "w2");
+  params.Create(-0.4, "w3");
+  params.Create(0.0, "b");
+  return params;
+}
+
+TEST(BatchTrainerTest, MatchesSerialGradients) {
+  auto params = CreateParameters();
+  auto w1 = params.Get(0);
+  auto w2 = params.Get(1);
+  auto w3 = params.Get(2);
+  auto b = params.Get(3);
+  std::vector<double> expected_grad(4, 0.0);
+  double expected_loss = 0.0;
+  for (size_t i = 0; i < kY.size(); i++) {
+    params.ZeroGrad();
+    auto diff = w1 * kX1[i] + w2 * kX2[i] + w3 * kX3[i] + b - kY[i];
+    auto loss = pow(diff, 2.0);
+    loss->Backward();
+    expected_loss += loss->GetData();
+    for (size_t p = 0; p < params.Size(); p++) {
+      expected_grad[p] += params.Get(p)->GetGrad();
+    }
+  }
+
+  params.ZeroGrad();
+  BatchTrainer trainer(&params, 4);
+  auto loss = trainer.ComputeGradients(0, kY.size(), SquaredError);
+
+  EXPECT_NEAR(loss, expected_loss, 1e-9);
+  for (size_t p = 0; p < params.Size(); p++) {
+    EXPECT_NEAR(params.Get(p)->GetGrad(), expected_grad[p], 1e-9);
+  }
+}
+
+TEST(BatchTrainerTest, Deterministic) {
+  auto params = CreateParameters();
+  BatchTrainer trainer(&params, 3);
+  std::vector<double> first;
+  std::vector<double> second;
+
+  trainer.ComputeGradients(0, kY.size(), SquaredError);
+  params.GatherGrad(&first);
+  params.ZeroGrad();
+  trainer.ComputeGradients(0, kY.size(), SquaredError);
+  params.GatherGrad(&second);
+
+  EXPECT_EQ(first, second);
+}
+
+TEST(BatchTrainerTest, Trains) {
+  auto params = CreateParameters();
+  BatchTrainer trainer(&params, 2);
+  Adam optimizer(&params, 0.1);
+
+  double loss = 0.0;
+  for (int epoch = 0; epoch < 3000; epoch++) {
+    optimizer.ZeroGrad();
+    loss = trainer.ComputeGradients(0, kY.size(), SquaredError);
+    optimizer.Step();
+  }
+
+  // The least-squares optimum from the normal equations.
+  EXPECT_NEAR(loss, 17.954493195, 1e-6);
+  EXPECT_NEAR(params.Get(0)->GetData(), 1.672029350, 1e-4);
+  EXPECT_NEAR(params.Get(3)->GetData(), 6.484032289, 1e-4);
+}
+
+} // namespace
+} // namespace micrograd
+} // namespace apexkid